@@ -1,8 +1,20 @@
 @ECHO OFF
 ROBOCOPY %~dp0 %cd% bd.conf /xn /xc /xo /NFL /NDL /NJH /NJS /nc /ns /np > NUL
-SET "GCC_CMD=gcc -Wall -O2 -D CONFIG="^<%cd%\bd.conf^>^" -o bd ^"%~dp0bd.c^""
+REM reuse the bd built before, as long as bd.c, bd.conf and gcc are the same
+IF NOT DEFINED BD_CACHE SET "BD_CACHE=%LOCALAPPDATA%\bd"
+FOR /F "delims=" %%H IN ('certutil -hashfile "%~dp0bd.c" SHA1 ^| FINDSTR /V :') DO SET "BD_C=%%H"
+FOR /F "delims=" %%H IN ('certutil -hashfile "%cd%\bd.conf" SHA1 ^| FINDSTR /V :') DO SET "BD_CONF=%%H"
+FOR /F "delims=" %%H IN ('gcc -dumpmachine') DO SET "BD_GCC=%%H"
+FOR /F "delims=" %%H IN ('gcc -dumpversion') DO SET "BD_GCC=%BD_GCC%-%%H"
+SET "BD_C=%BD_C: =%"
+SET "BD_CONF=%BD_CONF: =%"
+SET "BD_BIN=%BD_CACHE%\bd-%BD_C:~0,16%-%BD_CONF:~0,16%-%BD_GCC%.exe"
+IF EXIST "%BD_BIN%" GOTO run
+IF NOT EXIST "%BD_CACHE%" MKDIR "%BD_CACHE%"
+SET "GCC_CMD=gcc -Wall -O2 -D CONFIG="^<%cd%\bd.conf^>^" -o ^"%BD_BIN%^" ^"%~dp0bd.c^""
 ECHO %GCC_CMD%
 %GCC_CMD%
 IF %ERRORLEVEL% NEQ 0 EXIT /b %ERRORLEVEL%
-bd.exe %*
-DEL /q bd.exe REM optional
+:run
+"%BD_BIN%" %*
+EXIT /b %ERRORLEVEL%
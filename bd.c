@@ -38,6 +38,7 @@ SOFTWARE. */
     #define OS_DEF "OS_WIN"
     #define OS_WIN
     #define SLASH_STR   "\\"
+    #define OS_PATHSEP  ';'
     #include "windows.h"
     #include "fileapi.h"
     #include "errhandlingapi.h"
@@ -49,7 +50,22 @@ SOFTWARE. */
 #else
     /* common things by all others */
     #define SLASH_STR   "/"
+    #define OS_PATHSEP  ':'
     #include <errno.h>
+    #include <unistd.h>
+    #include <sys/wait.h>
+    #include <sys/resource.h>
+    #include <sys/mman.h>
+    #include <utime.h>
+    #include <spawn.h>
+    #include <signal.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <netinet/in.h>
+    #include <netdb.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    extern char **environ;
 #endif
 #if defined(OS_WIN)
 #elif defined(__CYGWIN__)
@@ -78,11 +94,15 @@ SOFTWARE. */
     #define OS_ANDROID
     /* Below __linux__ check should be enough to handle Android, */
     /* but something may be unique to Android. */
+    #include <sys/inotify.h>
+    #include <poll.h>
 #elif __linux__
     #define OS_STR "Linux"
     #define OS_DEF "OS_LINUX"
     #define OS_LINUX
     /* linux */
+    #include <sys/inotify.h>
+    #include <poll.h>
 #elif __unix__ /* all unices not caught above */
     #define OS_STR "Unix"
     #define OS_DEF "OS_UNIX"
@@ -98,26 +118,6 @@ SOFTWARE. */
 #endif
 /* end of os detection */
 
-/* start of pattern matching */
-#if defined(OS_WIN)
-    #define FIND(p) "cmd /V /C \"@echo off && setlocal enabledelayedexpansion && set \"var= %s\" && set \"var=!var:/=\\!\" && for %%I in (!var!) do set \"file=%%~dpnxI\" && set \"file=!file:%%cd%%\\=!\" && @echo !file!\"", p
-#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
-    #define FIND(p) "find \"$(dirname \"%s\")\" -maxdepth 1 -type f -name \"$(basename \"%s\")\"", p, p
-#endif
-/* end of pattern matching */
-
-/* start of deletion configuration */
-#if defined(OS_WIN)
-    char delfilestr[] = "del /q";
-    char delfoldstr[] = "rmdir";
-    char noerr[] = "2>nul";
-#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
-    char delfilestr[] = "rm";
-    char delfoldstr[] = "rm -d";
-    char noerr[] = "2>/dev/null";
-#endif
-/* end of deletion configuration */
-
 #ifndef CONFIG
 #define CONFIG  "bd.conf"
 #endif
@@ -127,50 +127,98 @@ SOFTWARE. */
 #define BD_MSG(bd,...)  if(!bd->quiet) { printf(__VA_ARGS__); printf("\n"); }
 #define BD_VERBOSE(bd,mes,...)  if(bd->verbose) { printf("%d:%s - "mes"\n", __LINE__, __func__, ##__VA_ARGS__); }
 #define SIZE_ARRAY(x)   (sizeof(x)/sizeof(*x))
+#define DEPLOG_ENT      20  /* u32 string id, u64 modification time, u64 content hash */
 #define strarr_free_p(x)    do { strarr_free(x); free(x); x = 0; } while(0)
 #define strarr_free_pa(...) do { for(int i = 0; i < SIZE_ARRAY(((StrArr*[]){__VA_ARGS__})); i++) strarr_free_p(((StrArr*[]){__VA_ARGS__})[i]); } while(0)
 
 /* structs */
 
+/* the strings are interned paths or literals and never owned, see path_intern() */
 typedef struct StrArr {
     char **s;
     int n;
+    int cap;        /* 0 for arrays from the configuration, they never grow */
 } StrArr;
 
+typedef struct DepFile {
+    char *buf;      /* contents of the file, the strings below point into it */
+    char **s;       /* prerequisites of the first rule, without the source */
+    int n;
+} DepFile;
+
 typedef enum {
    CMD_BUILD,
    CMD_CLEAN,
+   CMD_WATCH,
    CMD_LIST,
    CMD_CONFIG,
    CMD_OS,
+   CMD_BENCH,
+   CMD_WORKER,
    CMD_HELP,
    CMD_QUIET,
    CMD_NOERR,
    CMD_VERBOSE,
+   CMD_JOBS,
+   CMD_HASH,
+   CMD_CACHE,
+   CMD_CACHEMAX,
+   CMD_TRACE,
+   CMD_REMOTE,
+   CMD_ORDERED,
    /* commands above */
    CMD__COUNT
 } CmdList;
 static const char *static_cmds[CMD__COUNT] = {
    "build",
    "clean",
+   "watch",
    "list",
    "conf",
    "os",
+   "bench",
+   "worker",
    "-h",
    "-q",
    "-e",
    "-v",
+   "-j",
+   "--hash",
+   "--cache",
+   "--cache-max",
+   "--trace",
+   "--remote",
+   "--ordered",
 };
 static const char *static_cmdsinfo[CMD__COUNT] = {
     "Build the projects",
     "Clean created files",
+    "Build, then rebuild whenever a source or header changes",
     "List all projects (simple view)",
     "List all configurations",
     "Print the Operating System",
+    "Measure the overhead of bd itself, SPEC like files=1000,headers=200",
+    "Compile for others that use --remote, listening on ADDR (default: localhost:7700)",
     "Help output (this here)",
     "Execute quietly",
     "Also makes errors quiet",
     "Verbose output",
+    "Number of parallel jobs (default: what make allows, else online CPUs)",
+    "Only rebuild if the content of a file changed",
+    "Reuse objects compiled before, stored in folder DIR",
+    "Size limit of the object cache in MiB (default: 5120)",
+    "Write a timeline of the build to FILE (chrome://tracing)",
+    "Compile on the bd workers at ADDRS (comma separated host:port or socket paths)",
+    "Print what the jobs wrote sorted by file once the build is done, not as they finish",
+};
+static const char *static_cmdsarg[CMD__COUNT] = {
+    [CMD_JOBS] = "N",
+    [CMD_CACHE] = "DIR",
+    [CMD_CACHEMAX] = "MB",
+    [CMD_TRACE] = "FILE",
+    [CMD_BENCH] = "[SPEC]",
+    [CMD_WORKER] = "[ADDR]",
+    [CMD_REMOTE] = "ADDRS",
 };
 
 typedef enum {
@@ -200,32 +248,261 @@ static char *static_ext[BUILD__COUNT] = {
 #endif
 };
 
-typedef struct Bd {
-    StrArr ofiles;
-    int error;
-    int count;
-    bool quiet;
-    bool noerr;
-    bool done;
-    bool verbose;
-    char *cc_cxx;
-    bool use_cxx;
-} Bd;
-
 typedef struct Prj {
     char *cc;       /* c compiler */
     char *cxx;      /* cpp compiler */
+    char *ar;       /* archiver of static libraries */
     char *cflgs;    /* compile flags / options */   
     char *lopts;    /* linker flags / options */
     char *llibs;    /* linker library */
     char *name;     /* name of the thing */
     char *objd;     /* object directory */
     StrArr srcf;    /* source files */
+    StrArr supf;    /* support source files, compiled once and linked into every example */
     BuildList type; /* type */
+    StrArr deps;    /* names of projects that have to be linked before this one */
+    int unity;      /* compile batches of this many sources together, see prj_unity() */
+    bool unity_split;   /* compile a source on its own once it's the only change in its batch */
+    char *pch;      /* header to precompile and include in every source, see prj_pch() */
+    bool thin;      /* static libraries only reference the objects instead of containing them */
+    /* internal state below, not meant to be configured */
+    StrArr *srcfs;  /* expanded source files, see prj_srcfs() */
+    StrArr *supfs;  /* expanded support source files */
 } Prj;
 
+typedef struct StatEntry {
+    char *path;     /* normalized and interned path */
+    uint64_t time;  /* modification time, 0 if it doesn't exist */
+    uint64_t hash;  /* content hash, see filehash() */
+    bool hashed;
+    bool stale;     /* has to be looked up again */
+    bool watched;   /* a change triggers a rebuild, see watch() */
+} StatEntry;
+
+typedef struct StatCache {
+    StatEntry *e;
+    size_t n;
+    size_t cap;     /* always a power of two */
+    size_t hits;
+    size_t misses;
+    size_t hashed;
+} StatCache;
+
+typedef struct DepObj {
+    uint8_t *ents;      /* n * DEPLOG_ENT bytes */
+    uint32_t n;
+    uint64_t sig;       /* hash of the command it was built with, 0 if unknown */
+    uint32_t ms;        /* how long it took to build last time, 0 if unknown */
+    bool known;
+    bool dirty;         /* not yet written to the log file */
+    bool owned;         /* ents was allocated instead of pointing into the map */
+} DepObj;
+
+/* all dependencies of the objects (and targets) within one object directory, see deplog_load() */
+typedef struct DepLog {
+    char *path;         /* the log file */
+    char *objd;
+    char *map;          /* contents of the log file */
+    size_t size;
+    char **str;         /* interned strings, the index is the id */
+    DepObj *obj;        /* indexed by the string id of the object file or target */
+    uint32_t nstr;
+    uint32_t cap;       /* capacity of str and obj */
+    uint32_t *index;    /* hash table of string ids + 1 */
+    uint32_t capindex;  /* always a power of two */
+    uint32_t strfile;   /* number of strings already in the log file */
+    uint32_t records;   /* number of object records in the log file */
+    uint32_t live;      /* number of known objects */
+    bool rewrite;       /* the log file is missing or unusable */
+    bool dirty;
+    struct DepLog *next;
+} DepLog;
+
+typedef struct Job {
+    int pid;
+    char *objf;         /* object file compiled by this job, all paths are interned */
+    char *srcf;         /* its source */
+    char *depf;         /* dependency file written alongside */
+    DepLog *log;        /* where to ingest the dependencies */
+    uint64_t cachekey;  /* store the result in the object cache under this key, if set */
+    uint64_t sig;       /* hash of the command, logged once it succeeded */
+    uint64_t prevhash;  /* content of the object before it got compiled again, 0 if there was none */
+    int target;         /* index of the target that links the object, -1 if none */
+    int prj;            /* index of the project it belongs to */
+    bool link;          /* links the target objf instead of compiling it */
+    bool remote;        /* compiles on a worker, see remote_compile() */
+    char *msg;          /* printed along with its output, 0 if quiet */
+    int out;            /* file its output gets captured in, -1 if it goes straight to the terminal */
+    int lane;           /* row in the trace, never shared by running jobs */
+    double start;
+    double cpu;         /* user and system time, known when it's done */
+    size_t rss;         /* peak resident memory in KiB, known when it's done */
+} Job;
+
+/* what becomes of an argument of a compile command sent to a worker, see remote_arg() */
+typedef enum {
+    REMOTE_SEND,        /* the worker gets it */
+    REMOTE_DROP,        /* used up by preprocessing here */
+    REMOTE_REFUSE,      /* could make the worker read or write files, so it compiles here */
+} RemoteArg;
+
+/* one step on the timeline, see trace() */
+typedef struct TraceEvent {
+    const char *cat;
+    char *name;
+    double start;       /* seconds since bd started */
+    double wall;
+    double cpu;         /* of the child process, 0 for bd itself */
+    size_t rss;         /* of the child process */
+    int lane;           /* 0 for bd itself */
+} TraceEvent;
+
+/* output of a job held back for --ordered, see job_output() */
+typedef struct Held {
+    char *objf;
+    char *text;
+    int prj;
+    bool link;
+} Held;
+
+/* an object to compile, see build_schedule() */
+typedef struct Stale {
+    char *objf;
+    char *srcf;
+    char *depf;
+    char *cc_cxx;       /* compiler picked while checking it */
+    int prj;
+    int k;              /* target, see compile() */
+    int index;          /* in the order it was checked */
+    double prio;        /* seconds it and the links waiting on it take */
+} Stale;
+
+/* progress of one project during a build, see build() */
+typedef struct Build {
+    StrArr *objfs;
+    StrArr *depfs;
+    StrArr *targets;
+    StrArr *units;      /* compiled instead of just the sources, see prj_unity() and prj_supfs() */
+    bool pchdone[2];    /* the C / C++ precompiled header is up to date */
+    uint64_t pchtime[2];
+    bool *newlinks;     /* per target, set if it has to be linked again */
+    int *after;         /* indices of the projects to link before this one */
+    int nafter;
+    int waiting;        /* number of those not linked yet */
+    int pending;        /* stale objects not compiled yet, see build_schedule() */
+    int compiling;      /* compile jobs still running */
+    int linking;        /* link jobs still running */
+    double compiled;    /* longest compile of this build */
+    double linktime;    /* longest link of this build */
+    bool queued;        /* every source got checked */
+    bool started;       /* linking got started */
+    bool linked;
+} Build;
+
+/* memory that lives until bd exits, handed out in big blocks */
+typedef struct ArenaBlock {
+    struct ArenaBlock *prev;
+    size_t used;
+    size_t cap;
+    char data[];
+} ArenaBlock;
+
+typedef struct Arena {
+    ArenaBlock *block;
+    size_t allocs;
+    size_t blocks;
+    size_t bytes;
+} Arena;
+
+/* string builder with amortized growth */
+typedef struct Str {
+    char *s;
+    size_t len;
+    size_t cap;
+} Str;
+
+/* every path exists only once, so they can be compared by pointer */
+typedef struct PathTable {
+    char **e;
+    size_t n;
+    size_t cap;     /* always a power of two */
+    size_t lookups;
+} PathTable;
+
+/* size of the synthetic projects of `bd bench` */
+typedef struct BenchSpec {
+    int files;      /* source files, spread over all projects */
+    int headers;
+    int includes;   /* headers included by each source file */
+    int fanout;     /* headers included by each header */
+    int projects;   /* static, shared, app and examples, in turn */
+    int runs;       /* of each scenario */
+} BenchSpec;
+
+/* what `bd watch` keeps an eye on */
+typedef struct Watch {
+    int fd;         /* inotify instance, -1 when polling */
+    StrArr dirs;    /* folder of each watch descriptor */
+    size_t files;
+    bool rescan;    /* a source file appeared or vanished, expand the patterns again */
+} Watch;
+
+typedef struct Bd {
+    StrArr ofiles;
+    int error;
+    int count;      /* jobs started */
+    bool quiet;
+    bool noerr;
+    bool done;
+    bool verbose;
+    bool hash;      /* compare the content of files, not only their time */
+    char *cc_cxx;
+    bool use_cxx;
+    int jobs;       /* maximum number of concurrent jobs, 0 until jobserver_init() if not given */
+    int running;    /* number of currently running jobs */
+    Job *job;       /* the running jobs */
+    Prj *prj;       /* all configured projects */
+    int nprj;
+    Build *builds;  /* one per project, only while building */
+    Stale *stale;   /* objects to compile, only while building */
+    int nstale;
+    int capstale;
+    double critical;    /* longest chain of compiles and links, summed over all builds */
+    double buildtime;   /* time the builds took */
+    bool ordered;       /* hold the output of jobs until the build is done */
+    Held *held;
+    size_t nheld;
+    size_t capheld;
+    uint64_t *seen;     /* hashes of the warnings shown during this build, 0 is a free slot */
+    size_t nseen;
+    size_t capseen;     /* always a power of two */
+    size_t repeated;    /* warnings left out because they were shown already */
+    StatCache stats;
+    DepLog *logs;   /* dependency logs, one per object directory */
+    char *cache;    /* object cache folder, if any */
+    uint64_t cachemax;  /* size limit of the object cache in bytes */
+    size_t cachehits;
+    size_t cachemisses;
+    size_t cachestored;
+    Arena arena;
+    PathTable paths;
+    Str scratch;    /* reused by path_prf() */
+    char *trace;    /* file to write the timeline to, if any */
+    char *remote;   /* addresses of the workers to compile on, if any */
+    bool jobserver; /* every job but the first takes a token from jsread and gives it back to jswrite */
+    bool jsinit;    /* looked for a jobserver already, see jobserver_init() */
+    int jsread;
+    int jswrite;
+    Str tokens;     /* the tokens taken, given back as they came */
+    double t0;      /* when bd started */
+    TraceEvent *events;
+    size_t nevents;
+    size_t capevents;
+} Bd;
+
 static char static_cc_def[] = "gcc";
 static char static_cxx_def[] = "g++";
+static char static_ar_def[] = "ar";
 
 /* all function prototypes */
 static char *strprf(char *str, char *format, ...);
@@ -235,23 +512,141 @@ static void prj_print(Bd *bd, Prj *p, bool simple);
 static StrArr *strarr_new();
 static void strarr_free(StrArr *arr);
 static bool strarr_set_n(StrArr *arr, int n);
-static bool parse_pipe(Bd *bd, char *cmd, StrArr **result);
-static StrArr *parse_dfile(Bd *bd, char *dfile);
+static bool strarr_push(Bd *bd, StrArr *arr, char *s);
+static void *arena_alloc(Arena *arena, size_t size);
+static void arena_free(Arena *arena);
+static bool str_vapp(Str *str, const char *format, va_list argp);
+static bool str_app(Str *str, const char *format, ...);
+static void str_free(Str *str);
+static char *path_intern(Bd *bd, const char *s, size_t len);
+static char *path_prf(Bd *bd, const char *format, ...);
+static void path_free(PathTable *pt);
+static size_t peak_rss(void);
+static char *read_file(Bd *bd, const char *filename, size_t *len);
+static DepFile *parse_dfile(Bd *bd, char *dfile);
+static void depfile_free(DepFile *df);
 static int strrstr(const char *s1, const char *s2);
+static int strarr_cmp(const void *a, const void *b);
+static bool wildcard(const char *pat, const char *str);
+static void glob_dir(Bd *bd, char *dir, char *pat, StrArr *result);
+static uint64_t strhash(const char *s);
+static StatEntry *statcache_find(StatCache *sc, const char *path);
+static bool statcache_grow(StatCache *sc);
+static void statcache_forget(Bd *bd, const char *filename);
+static void statcache_free(StatCache *sc);
+static uint64_t modtime_stat(Bd *bd, const char *filename);
+static StatEntry *statcache_get(Bd *bd, const char *filename);
 static uint64_t modtime(Bd *bd, const char *filename);
+static uint64_t hash_data(const void *data, size_t len);
+static uint64_t filehash(Bd *bd, const char *filename);
+static uint64_t libhash(Bd *bd, const char *filename);
+static uint64_t dephash(Bd *bd, const char *filename, bool hash);
+static StrArr *libpaths(Bd *bd, char *llibs);
 static uint64_t modlibs(Bd *bd, char *llibs);
 static void makedir(const char *dirname);
+static DepLog *deplog_get(Bd *bd, char *objd);
+static uint32_t deplog_u32(const char *p);
+static uint64_t deplog_u64(const char *p);
+static void deplog_load(Bd *bd, DepLog *log);
+static bool deplog_reserve(DepLog *log, uint32_t n);
+static uint32_t deplog_find(DepLog *log, const char *s);
+static uint32_t deplog_intern(Bd *bd, DepLog *log, const char *s, bool copy);
+static void deplog_record(Bd *bd, DepLog *log, char *key, char **files, int n, bool hash);
+static void deplog_ingest(Bd *bd, DepLog *log, char *objf, char *srcf, char *depf, bool hash);
+static int deplog_check(Bd *bd, DepLog *log, char *key, uint64_t m_key, bool hash);
+static void deplog_sign(Bd *bd, DepLog *log, char *key, uint64_t sig);
+static bool deplog_signed(Bd *bd, DepLog *log, char *key, uint64_t sig);
+static void deplog_time(Bd *bd, DepLog *log, char *key, double seconds);
+static double deplog_took(DepLog *log, char *key);
+static bool deplog_write(Bd *bd, DepLog *log, bool compact);
+static void deplog_flush(Bd *bd, DepLog *log, bool final);
+static void deplog_free(DepLog *log);
+static void deplog_drop(Bd *bd, char *objd);
+static char *tmp_path(const char *path);
+static bool copy_file(const char *from, const char *to);
+static uint64_t compiler_id(Bd *bd, char *cc);
+static char *cache_path(Bd *bd, uint64_t key, const char *ext, bool create);
+static uint64_t cache_direct(Bd *bd, char *cmd, char *srcf, char *pchf);
+static bool cache_restore(Bd *bd, uint64_t direct, char *objf, char *depf);
+static void cache_store(Bd *bd, uint64_t direct, DepLog *log, char *objf, char *depf);
+static void cache_trim(Bd *bd);
+static int cpu_count(void);
+static void jobserver_init(Bd *bd);
+static bool jobserver_take(Bd *bd);
+static void jobserver_give(Bd *bd);
+static bool job_slot(Bd *bd);
+static char **cmd_argv(char *cmd);
+static int cmd_spawn(Bd *bd, char *cmd, int out);
+static int job_capture(Bd *bd);
+static bool line_has(const char *line, size_t len, const char *s);
+static bool seen_add(Bd *bd, uint64_t hash);
+static void output_filter(Bd *bd, Str *text, char *buf, size_t len);
+static void job_output(Bd *bd, Job *job, int code);
+static int held_cmp(const void *a, const void *b);
+static void held_flush(Bd *bd);
+static void job_start(Bd *bd, char *cmd, Job *job);
+static void job_done(Bd *bd, Job *job, int code);
+static void build_changed(Bd *bd, Build *b, Job *job);
+static void job_reap(Bd *bd, int pid, int status, void *usage);
+static void job_wait(Bd *bd);
+static void job_wait_all(Bd *bd);
+static int remote_connect(Bd *bd, const char *addr, bool listening);
+static bool remote_io(int fd, char *buf, size_t len, bool send);
+static char *remote_header(int fd);
+static int remote_spawn(Bd *bd, char *cmd, Job *job);
+static int remote_compile(Bd *bd, char *cmd, Job *job);
+static bool cc_gnu(const char *cmd);
+static RemoteArg remote_arg(const char *arg, bool *skip);
+static bool remote_able(char **argv, const char *srcf);
+static bool worker_allowed(char **argv);
+static void worker_serve(Bd *bd, int fd);
+static void worker(Bd *bd, const char *addr);
 static StrArr *extract_dirs(Bd *bd, char *path, bool skiplast);
-static void compile(Bd *bd, Prj *p, char *name, char *objf, char *srcf);
+static void compile(Bd *bd, Prj *p, int k, char *objf, char *srcf, char *depf);
 static void verify_cc_cxx(Bd *bd, Prj *p, char *filename);
-static void link(Bd *bd, Prj *p, char *name, bool avoidlink);
-static void build(Bd *bd, Prj *p);
-static void delete_cmd(Bd *bd, char *target, char *to_delete, bool folder);
+static void link_objs(Bd *bd, int i, char *name, bool avoidlink);
+static bool prj_links(Bd *bd, Prj *p, Prj *dep);
+static void build_compile(Bd *bd, int i);
+static void build_link(Bd *bd, int i);
+static void build_linked(Bd *bd, int i);
+static void build_ready(Bd *bd);
+static void build_order(Bd *bd, int *order);
+static int stale_cmp(const void *a, const void *b);
+static void build_schedule(Bd *bd, int *order);
+static void build(Bd *bd);
+static int delete_paths(Bd *bd, StrArr *paths, bool folder);
 static void clean(Bd *bd, Prj *p);
-static void bd_execute(Bd *bd, CmdList cmd);
+static void watch_file(Bd *bd, Watch *w, const char *path);
+static void watch_register(Bd *bd, Watch *w);
+static bool watch_wait(Bd *bd, Watch *w);
+static void watch(Bd *bd);
+static double timer_now(void);
+static void bench_dfile(Bd *bd, bool crlf);
+static bool bench_spec(Bd *bd, const char *arg, BenchSpec *spec);
+static int bench_cmp(const void *a, const void *b);
+static int bench_child(BenchSpec *spec, int h, int f);
+static char *bench_generate(Bd *bd, BenchSpec *spec, Prj *prjs);
+static void bench_reset(Bd *bd);
+static void bench_run(Bd *bd, BenchSpec *spec, const char *scenario, char *touch);
+static void bench_projects(Bd *bd, BenchSpec *spec);
+static void bench(Bd *bd, const char *arg);
+static double cpu_time(void);
+static void trace(Bd *bd, const char *cat, const char *name, double start, int lane, double cpu, size_t rss);
+static void json_str(FILE *fp, const char *s);
+static int trace_cmp(const void *a, const void *b);
+static void trace_write(Bd *bd);
+static void bd_execute(Bd *bd, CmdList cmd, const char *arg);
 static StrArr *prj_names(Bd *bd, Prj *p, StrArr *srcfs);
+static StrArr *prj_glob(Bd *bd, StrArr *pats, StrArr *exclude);
 static StrArr *prj_srcfs(Bd *bd, Prj *p);
+static StrArr *prj_supfs(Bd *bd, Prj *p);
 static StrArr *prj_srcfs_chg_dirext(Bd *bd, StrArr *srcfs, char *new_dir, char *new_ext);
+static bool src_is_cxx(const char *filename);
+static StrArr *prj_unity(Bd *bd, Prj *p, StrArr *srcfs, bool generate, int *batches);
+static bool prj_cxx(Bd *bd, Prj *p);
+static char *prj_pch(Bd *bd, Prj *p, bool cxx);
+static uint64_t pch_build(Bd *bd, int i);
+static int obj_changed(Bd *bd, DepLog *log, char *objf, char *srcf, char *depf, uint64_t m_objf, uint64_t sig);
 
 /* function implementations */
 static char *strprf(char *str, char *format, ...)
@@ -261,20 +656,12 @@ static char *strprf(char *str, char *format, ...)
     va_list argp;
     va_start(argp, format);
     int len_app = vsnprintf(0, 0, format, argp);
-    int len_original = 0;
     va_end(argp);
-    /* make sure to have enough memory */
-    char *original = 0;
-    if(str) {
-        len_original = strlen(str);
-        original = strprf(0, str);
-    }
+    /* make sure to have enough memory, realloc keeps the original */
+    int len_original = str ? strlen(str) : 0;
     void *temp = realloc(str, len_original + len_app + 1);
     if(!temp) return 0;
     char *result = temp;
-    if(result != str) {
-        memcpy(result, original, len_original);
-    }
     /* actual append */
     va_start(argp, format);
     vsnprintf(&result[len_original], len_app + 1, format, argp);
@@ -285,11 +672,17 @@ static char *strprf(char *str, char *format, ...)
 
 static char *static_cc_cxx(Bd *bd, Prj *p, char *ofile, char *cfile)
 {
+    /* the precompiled header is compiled as such, everything else includes it */
+    bool cxx = prj_cxx(bd, p);
+    char *xlang = (p->pch && !strcmp(cfile, p->pch)) ? (cxx ? "-x c++-header " : "-x c-header ") : "";
+    char *pch = (p->pch && !*xlang) ? prj_pch(bd, p, cxx) : 0;
+    char *incl = pch ? " -include " : "";
+    if(!pch) pch = "";
     switch(p->type) {
         case BUILD_APP      : ;
-        case BUILD_EXAMPLES : return strprf(0, "%s -c -MMD -MP %s%s-D%s -o %s %s", bd->cc_cxx, p->cflgs ? p->cflgs : "", p->cflgs ? " " : "", OS_DEF, ofile, cfile);
-        case BUILD_STATIC   : return strprf(0, "%s -c -MMD -MP %s%s-D%s -o %s %s", bd->cc_cxx, p->cflgs ? p->cflgs : "", p->cflgs ? " " : "", OS_DEF, ofile, cfile);
-        case BUILD_SHARED   : return strprf(0, "%s -c -MMD -MP -fPIC -D%s%s%s -o %s %s", bd->cc_cxx, p->cflgs ? p->cflgs : "", p->cflgs ? " " : "", OS_DEF, ofile, cfile);
+        case BUILD_EXAMPLES : return strprf(0, "%s -c -MMD -MP %s%s-D%s%s%s -o %s %s%s", bd->cc_cxx, p->cflgs ? p->cflgs : "", p->cflgs ? " " : "", OS_DEF, incl, pch, ofile, xlang, cfile);
+        case BUILD_STATIC   : return strprf(0, "%s -c -MMD -MP %s%s-D%s%s%s -o %s %s%s", bd->cc_cxx, p->cflgs ? p->cflgs : "", p->cflgs ? " " : "", OS_DEF, incl, pch, ofile, xlang, cfile);
+        case BUILD_SHARED   : return strprf(0, "%s -c -MMD -MP -fPIC %s%s-D%s%s%s -o %s %s%s", bd->cc_cxx, p->cflgs ? p->cflgs : "", p->cflgs ? " " : "", OS_DEF, incl, pch, ofile, xlang, cfile);
         default             : return 0;
     }
 }
@@ -298,7 +691,7 @@ static char *static_ld(Bd *bd, Prj *p, char *name, char *ofiles, char *libstuff)
     switch(p->type) {
         case BUILD_APP      : ;
         case BUILD_EXAMPLES : return strprf(0, "%s %s%s-o %s %s %s", bd->cc_cxx, p->lopts ? p->lopts : "", p->lopts ? " " : "", name, ofiles, libstuff ? libstuff : "");
-        case BUILD_STATIC   : return strprf(0, "ar rcs %s%s %s", name, static_ext[p->type], ofiles);
+        case BUILD_STATIC   : return strprf(0, "%s rcs%s %s%s %s", p->ar ? p->ar : static_ar_def, p->thin ? "T" : "", name, static_ext[p->type], ofiles);
         case BUILD_SHARED   : return strprf(0, "%s -shared -fPIC %s%s-o %s%s %s %s", bd->cc_cxx, p->lopts ? p->lopts : "", p->lopts ? " " : "", name, static_ext[p->type], ofiles, libstuff ? libstuff : "");
         default             : return 0;
     }
@@ -319,16 +712,21 @@ static void prj_print(Bd *bd, Prj *p, bool simple) /* TODO list if they're up to
 
     /* print all names */
     for(int i = 0; i < targets->n; i++) printf("%-7s : \033[1m[ %s ]\033[0m\n", static_build_str[p->type], targets->s[i]);
-    strarr_free_pa(srcfs, targets);
+    strarr_free_pa(objfs, depfs, targets);
     if(simple) return;
     /* print the configuration */
     printf("  cc    = %s\n", p->cc ? p->cc : static_cc_def);
     printf("  cxx   = %s\n", p->cxx ? p->cxx : static_cxx_def);
+    if(p->type == BUILD_STATIC) printf("  ar    = %s\n", p->ar ? p->ar : static_ar_def);
     if(p->cflgs) printf("  cflgs = %s\n", p->cflgs);
     if(p->lopts) printf("  lopts = %s\n", p->lopts);
     if(p->llibs) printf("  llibs = %s\n", p->llibs);
     if(p->objd) printf("  objd  = [%s]\n", p->objd);
+    for(int i = 0; i < p->deps.n; i++) printf("  deps  = %s\n", p->deps.s[i]);
+    if(p->pch) printf("  pch   = %s\n", p->pch);
+    if(p->unity > 0) printf("  unity = %d%s\n", p->unity, p->unity_split ? " (split)" : "");
     for(int i = 0; i < p->srcf.n; i++) printf("%4s%s\n", "", p->srcf.s[i]);
+    for(int i = 0; i < p->supf.n; i++) printf("%4s%s (support)\n", "", p->supf.s[i]);
 }
 
 static StrArr *strarr_new()
@@ -342,93 +740,295 @@ static StrArr *strarr_new()
 static void strarr_free(StrArr *arr)
 {
     if(!arr) return;
-    for(int i = 0; i < arr->n; i++) free(arr->s[i]);
     free(arr->s);
     arr->s = 0;
     arr->n = 0;
+    arr->cap = 0;
 }
 
 static bool strarr_set_n(StrArr *arr, int n)
 {
     if(!arr || !n) return false;
-    if(arr->n == n) return true;
-    void *temp = realloc(arr->s, sizeof(*arr->s) * (n));
-    if(!temp) return false;
-    arr->s = temp;
-    memset(&arr->s[arr->n], 0, sizeof(*arr->s) * (n - arr->n));
+    if(n > arr->cap) {
+        int cap = arr->cap ? arr->cap * 2 : 16;
+        while(cap < n) cap *= 2;
+        void *temp = realloc(arr->s, sizeof(*arr->s) * cap);
+        if(!temp) return false;
+        arr->s = temp;
+        arr->cap = cap;
+    }
+    if(n > arr->n) memset(&arr->s[arr->n], 0, sizeof(*arr->s) * (n - arr->n));
     arr->n = n;
     return true;
 }
 
-static bool parse_pipe(Bd *bd, char *cmd, StrArr **result)
+static bool strarr_push(Bd *bd, StrArr *arr, char *s)
 {
-    FILE *fp = popen(cmd, "r");
-    if(!fp) BD_ERR(bd, false, "Could not open pipe");
+    if(!s) BD_ERR(bd, false, "Failed to create string");
+    if(!strarr_set_n(arr, arr->n + 1)) BD_ERR(bd, false, "Failed to modify StrArr");
+    arr->s[arr->n - 1] = s;
+    return true;
+}
 
-    if(!*result) *result = strarr_new();
-    if(!*result) BD_ERR(bd, false, "Failed to create StrArr");
-    int c = fgetc(fp);
-    int n = (*result)->n + 1;
-    while(c != EOF) {
-        if(c == '\n') n++;
-        else if(c != '\r') {
-            if(!strarr_set_n(*result, n)) BD_ERR(bd, false, "Failed to modify StrArr");
-            (*result)->s[(*result)->n - 1] = strprf((*result)->s[(*result)->n - 1], "%c", c);
-        }
-        c = fgetc(fp);
+static void *arena_alloc(Arena *arena, size_t size)
+{
+    size = (size + 7) & ~(size_t)7;
+    ArenaBlock *block = arena->block;
+    if(!block || block->cap - block->used < size) {
+        size_t cap = size > 0x10000 ? size : 0x10000;
+        block = malloc(sizeof(*block) + cap);
+        if(!block) return 0;
+        block->prev = arena->block;
+        block->used = 0;
+        block->cap = cap;
+        arena->block = block;
+        arena->blocks++;
+    }
+    void *result = &block->data[block->used];
+    block->used += size;
+    arena->allocs++;
+    arena->bytes += size;
+    return result;
+}
+
+static void arena_free(Arena *arena)
+{
+    while(arena->block) {
+        ArenaBlock *prev = arena->block->prev;
+        free(arena->block);
+        arena->block = prev;
     }
+    memset(arena, 0, sizeof(*arena));
+}
 
-    if(pclose(fp)) BD_ERR(bd, false, "Could not close pipe");
-    if(!(*result)->n) {    /* TODO check other functions that use `strarr_new()` to maybe also return 0 when empty... */
-        free(*result);
-        *result = 0;
+static bool str_vapp(Str *str, const char *format, va_list argp)
+{
+    va_list copy;
+    va_copy(copy, argp);
+    int len = vsnprintf(str->s ? &str->s[str->len] : 0, str->s ? str->cap - str->len : 0, format, copy);
+    va_end(copy);
+    if(len < 0) return false;
+    if(str->len + len + 1 > str->cap) {
+        size_t cap = str->cap ? str->cap * 2 : 256;
+        while(cap < str->len + len + 1) cap *= 2;
+        void *temp = realloc(str->s, cap);
+        if(!temp) return false;
+        str->s = temp;
+        str->cap = cap;
+        vsnprintf(&str->s[str->len], str->cap - str->len, format, argp);
     }
+    str->len += len;
     return true;
 }
 
-static StrArr *parse_dfile(Bd *bd, char *dfile)
+static bool str_app(Str *str, const char *format, ...)
 {
-    FILE *fp = fopen(dfile, "rb");
-    if(!fp) return 0;
+    va_list argp;
+    va_start(argp, format);
+    bool result = str_vapp(str, format, argp);
+    va_end(argp);
+    return result;
+}
 
-    StrArr *result = strarr_new();
-    if(!result) BD_ERR(bd, 0, "Failed to create StrArr");
+static void str_free(Str *str)
+{
+    free(str->s);
+    memset(str, 0, sizeof(*str));
+}
 
-    /* skip first line */
-    int c = fgetc(fp);
-    while(c != '\n') {
-        if(c == '\\') {
-            c = fgetc(fp);  /* skip '\r' under windows ; '\n' under linux */
-            if(c == '\r') fgetc(fp);  /* skip '\n' under windows */
-        }    
-        c = fgetc(fp);
-    }
-    c = fgetc(fp);
-    /* read in the required files */
-    int n = 0;
-    bool wasdot = false;
-    while(c != EOF) {
-        if(c == '\n') {
-            wasdot = false;
-            n++;
-        }
-        else if(c == '\r') {}
-        else {
-            if(c == '.') wasdot = true;
-            if(!n) n = 1;
-            if(!strarr_set_n(result, n)) BD_ERR(bd, 0, "Failed to modify StrArr");
-            if(c != ':' || !wasdot) result->s[result->n - 1] = strprf(result->s[result->n - 1], "%c", c);
+/* the returned path lives until bd exits */
+static char *path_intern(Bd *bd, const char *s, size_t len)
+{
+    PathTable *pt = &bd->paths;
+    if(pt->n * 2 >= pt->cap) {
+        PathTable grown = *pt;
+        grown.cap = pt->cap ? pt->cap * 2 : 1024;
+        grown.e = calloc(grown.cap, sizeof(*grown.e));
+        if(!grown.e) BD_ERR(bd, 0, "Failed to grow path table");
+        for(size_t i = 0; i < pt->cap; i++) {
+            if(!pt->e[i]) continue;
+            size_t j = strhash(pt->e[i]) & (grown.cap - 1);
+            while(grown.e[j]) j = (j + 1) & (grown.cap - 1);
+            grown.e[j] = pt->e[i];
         }
-        c = fgetc(fp);
+        free(pt->e);
+        *pt = grown;
+    }
+    pt->lookups++;
+    /* same as strhash(), but limited to len */
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for(size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 0x100000001b3ULL;
+    }
+    size_t mask = pt->cap - 1;
+    size_t j = h & mask;
+    for(; pt->e[j]; j = (j + 1) & mask) {
+        if(!strncmp(pt->e[j], s, len) && !pt->e[j][len]) return pt->e[j];
     }
+    char *result = arena_alloc(&bd->arena, len + 1);
+    if(!result) BD_ERR(bd, 0, "Failed to allocate path");
+    memcpy(result, s, len);
+    result[len] = 0;
+    pt->e[j] = result;
+    pt->n++;
+    return result;
+}
 
-    BD_VERBOSE(bd, "found %d header files for '%s'", result->n, dfile);
-    if(!result->n) strarr_free_p(result);
+static char *path_prf(Bd *bd, const char *format, ...)
+{
+    Str *str = &bd->scratch;
+    str->len = 0;
+    va_list argp;
+    va_start(argp, format);
+    bool formatted = str_vapp(str, format, argp);
+    va_end(argp);
+    if(!formatted) BD_ERR(bd, 0, "Failed to format path");
+    return path_intern(bd, str->s, str->len);
+}
+
+static void path_free(PathTable *pt)
+{
+    free(pt->e);
+    memset(pt, 0, sizeof(*pt));
+}
+
+/* in KiB, 0 if unknown */
+static size_t peak_rss(void)
+{
+#if defined(OS_WIN)
+    return 0;
+#elif defined(OS_APPLE)
+    struct rusage usage = {0};
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t)usage.ru_maxrss / 1024;
+#elif defined(OS_CYGWIN) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    struct rusage usage = {0};
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t)usage.ru_maxrss;
+#endif
+}
 
-    if(fclose(fp)) BD_ERR(bd, 0, "Could not close dfile");
+/* the whole file with a terminating 0 in one allocation */
+static char *read_file(Bd *bd, const char *filename, size_t *len)
+{
+    FILE *fp = fopen(filename, "rb");
+    if(!fp) return 0;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *data = size >= 0 ? malloc(size + 1) : 0;
+    if(!data || fread(data, 1, size, fp) != (size_t)size) {
+        free(data);
+        fclose(fp);
+        BD_ERR(bd, 0, "Could not read '%s'", filename);
+    }
+    fclose(fp);
+    data[size] = 0;
+    if(len) *len = size;
+    return data;
+}
+
+/* tokenize the first rule of a dependency file in a single pass over one buffer ;
+ * handles '\ ' / '\#' / '$$' escapes, '\' continuations and CRLF line endings */
+static DepFile *parse_dfile(Bd *bd, char *dfile)
+{
+    size_t size = 0;
+    char *buf = read_file(bd, dfile, &size);
+    if(!buf) return 0;
+    DepFile *result = calloc(1, sizeof(*result));
+    if(!result) {
+        free(buf);
+        BD_ERR(bd, 0, "Failed to create DepFile");
+    }
+    result->buf = buf;
+    /* unescaping never makes a token longer, so it's done in place ; the terminating 0
+     * of a token may overwrite its delimiter, which is why that one is looked at first */
+    char *r = buf, *w = buf, *end = buf + size;
+    bool targets = true;
+    int cap = 0;
+    while(r < end) {
+        if(*r == ' ' || *r == '\t' || *r == '\r') {
+            r++;
+            continue;
+        }
+        if(*r == '\\' && r + 1 < end && (r[1] == '\n' || (r[1] == '\r' && r + 2 < end && r[2] == '\n'))) {
+            r += (r[1] == '\n') ? 2 : 3;
+            continue;
+        }
+        if(*r == '\n') {
+            /* end of the first rule, the rest are the phony targets of -MP */
+            if(!targets) break;
+            r++;
+            continue;
+        }
+        if(*r == ':') {
+            targets = false;
+            r++;
+            continue;
+        }
+        char *token = w;
+        while(r < end) {
+            char c = *r;
+            if(c == '\\' && r + 1 < end && (r[1] == ' ' || r[1] == '\t' || r[1] == '#')) {
+                *w++ = r[1];
+                r += 2;
+            } else if(c == '$' && r + 1 < end && r[1] == '$') {
+                *w++ = '$';
+                r += 2;
+            } else if(c == '\\' && r + 1 < end && (r[1] == '\n' || r[1] == '\r')) {
+                break;
+            } else if(c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                break;
+            } else if(c == ':' && (r + 1 == end || r[1] == ' ' || r[1] == '\t' || r[1] == '\r' || r[1] == '\n')) {
+                break;
+            } else {
+                *w++ = *r++;
+            }
+        }
+        if(!targets) {
+            if(result->n == cap) {
+                cap = cap ? cap * 2 : 64;
+                void *temp = realloc(result->s, sizeof(*result->s) * cap);
+                if(!temp) {
+                    depfile_free(result);
+                    BD_ERR(bd, 0, "Failed to grow DepFile");
+                }
+                result->s = temp;
+            }
+            result->s[result->n++] = token;
+        }
+        char delim = r < end ? *r : 0;
+        *w++ = 0;
+        if(delim == ':') {
+            targets = false;
+            r++;
+        } else if(delim == '\\') {
+            r += (r[1] == '\n') ? 2 : 3;
+        } else if(delim == '\n') {
+            if(!targets) break;
+            r++;
+        } else if(delim) {
+            r++;
+        }
+    }
+    /* the first prerequisite is the source itself */
+    if(result->n) {
+        result->n--;
+        memmove(result->s, result->s + 1, sizeof(*result->s) * result->n);
+    }
+    BD_VERBOSE(bd, "found %d header files for '%s'", result->n, dfile);
     return result;
 }
 
+static void depfile_free(DepFile *df)
+{
+    if(!df) return;
+    free(df->buf);
+    free(df->s);
+    free(df);
+}
+
 static int strrstr(const char *s1, const char *s2)
 {
    const int len_s1 = strlen(s1);
@@ -439,7 +1039,177 @@ static int strrstr(const char *s1, const char *s2)
    return -1;
 }
 
-static uint64_t modtime(Bd *bd, const char *filename)
+static int strarr_cmp(const void *a, const void *b)
+{
+    return strcmp(*(char **)a, *(char **)b);
+}
+
+/* match a single path component against '*', '?' and '[...]', like a shell would */
+static bool wildcard(const char *pat, const char *str)
+{
+    for(; *pat; pat++, str++) {
+        switch(*pat) {
+            case '*': {
+                while(*pat == '*') pat++;
+                if(!*pat) return true;
+                for(; *str; str++) if(wildcard(pat, str)) return true;
+                return false;
+            }
+            case '?': {
+                if(!*str) return false;
+            } break;
+            case '[': {
+                const char *c = pat + 1;
+                bool negate = (*c == '!' || *c == '^');
+                bool found = false;
+                if(negate) c++;
+                do {
+                    if(c[0] && c[1] == '-' && c[2] && c[2] != ']') {
+                        found |= (*str >= c[0] && *str <= c[2]);
+                        c += 3;
+                    } else {
+                        found |= (*str == *c);
+                        if(*c) c++;
+                    }
+                } while(*c && *c != ']');
+                if(!*c) {
+                    /* no closing bracket, treat it literally */
+                    if(*str != '[') return false;
+                    break;
+                }
+                if(!*str || found == negate) return false;
+                pat = c;
+            } break;
+            default: {
+                if(*pat != *str) return false;
+            }
+        }
+    }
+    return !*str;
+}
+
+/* expand the remaining pattern components of `pat` inside `dir` (empty or ending with a slash) */
+static void glob_dir(Bd *bd, char *dir, char *pat, StrArr *result)
+{
+    if(bd->error) return;
+    /* patterns may use either separator, the paths found use the one of the OS */
+    while(*pat == '/' || *pat == SLASH_STR[0]) pat++;
+    if(!*pat) return;
+    char *slash = strpbrk(pat, "/" SLASH_STR);
+    int len = slash ? (int)(slash - pat) : (int)strlen(pat);
+    char *rest = slash ? slash + 1 : 0;
+    char *comp = strprf(0, "%.*s", len, pat);
+    bool recursive = !strcmp(comp, "**");
+    if(!strcmp(comp, ".")) {
+        /* keep paths normalized so duplicates can be found */
+        if(rest) glob_dir(bd, dir, rest, result);
+        free(comp);
+        return;
+    } else if(recursive) {
+        /* '**' also matches no directory at all */
+        glob_dir(bd, dir, rest ? rest : "*", result);
+    } else if(!strpbrk(comp, "*?[")) {
+        /* no need to read the directory for a literal component */
+        char *path = path_prf(bd, "%s%s", dir, comp);
+        struct stat attr = {0};
+        if(path && !stat(path, &attr)) {
+            if(rest && S_ISDIR(attr.st_mode)) {
+                glob_dir(bd, path_prf(bd, "%s%s", path, SLASH_STR), rest, result);
+            } else if(!rest && S_ISREG(attr.st_mode)) {
+                strarr_push(bd, result, path);
+            }
+        }
+        free(comp);
+        return;
+    }
+    DIR *dp = opendir(*dir ? dir : ".");
+    if(!dp) {
+        BD_VERBOSE(bd, "could not open directory '%s'", dir);
+        free(comp);
+        return;
+    }
+    struct dirent *entry;
+    while((entry = readdir(dp)) && !bd->error) {
+        if(!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) continue;
+        /* hidden entries have to be matched explicitly */
+        if(entry->d_name[0] == '.' && comp[0] != '.') continue;
+        if(!recursive && !wildcard(comp, entry->d_name)) continue;
+        char *path = path_prf(bd, "%s%s", dir, entry->d_name);
+        if(!path) break;
+        bool isdir = false, isreg = false;
+#if defined(_DIRENT_HAVE_D_TYPE)
+        isdir = (entry->d_type == DT_DIR);
+        isreg = (entry->d_type == DT_REG);
+        if(entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
+#endif
+        {
+            struct stat attr = {0};
+            if(!stat(path, &attr)) {
+                isdir = S_ISDIR(attr.st_mode);
+                isreg = S_ISREG(attr.st_mode);
+            }
+        }
+        if(isdir && (rest || recursive)) {
+            glob_dir(bd, path_prf(bd, "%s%s", path, SLASH_STR), recursive ? pat : rest, result);
+        } else if(isreg && !rest && !recursive) {
+            strarr_push(bd, result, path);
+        }
+    }
+    closedir(dp);
+    free(comp);
+}
+
+/* FNV-1a */
+static uint64_t strhash(const char *s)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for(; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/* returns either the entry of `path` or the empty slot it belongs into */
+static StatEntry *statcache_find(StatCache *sc, const char *path)
+{
+    size_t mask = sc->cap - 1;
+    size_t i = strhash(path) & mask;
+    while(sc->e[i].path && strcmp(sc->e[i].path, path)) i = (i + 1) & mask;
+    return &sc->e[i];
+}
+
+static bool statcache_grow(StatCache *sc)
+{
+    StatCache grown = *sc;
+    grown.cap = sc->cap ? sc->cap * 2 : 256;
+    grown.e = calloc(grown.cap, sizeof(*grown.e));
+    if(!grown.e) return false;
+    for(size_t i = 0; i < sc->cap; i++) {
+        if(sc->e[i].path) *statcache_find(&grown, sc->e[i].path) = sc->e[i];
+    }
+    free(sc->e);
+    *sc = grown;
+    return true;
+}
+
+/* call this whenever bd itself (re)creates a file */
+static void statcache_forget(Bd *bd, const char *filename)
+{
+    if(!bd->stats.cap) return;
+    while(filename[0] == '.' && filename[1] == '/') filename += 2;
+    StatEntry *entry = statcache_find(&bd->stats, filename);
+    if(entry->path) entry->stale = true;
+}
+
+static void statcache_free(StatCache *sc)
+{
+    free(sc->e);
+    memset(sc, 0, sizeof(*sc));
+}
+
+/* modification time in 100ns (windows) or 1ns (everything else) intervals */
+static uint64_t modtime_stat(Bd *bd, const char *filename)
 {
 #if defined(OS_WIN)
     HANDLE filehandle = CreateFileA(filename, GENERIC_READ, 0, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
@@ -460,53 +1230,228 @@ static uint64_t modtime(Bd *bd, const char *filename)
     return result.QuadPart;
 #elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
     struct stat attr = {0};
-    if(stat(filename, &attr) == -1 && errno != ENOENT ) {
-        BD_ERR(bd, 0, "%s: %s", filename, strerror(errno));
+    if(stat(filename, &attr) == -1) {
+        if(errno != ENOENT && errno != ENOTDIR) BD_ERR(bd, 0, "%s: %s", filename, strerror(errno));
+        return 0;
     }
-    return (uint64_t)attr.st_ctime;
+#if defined(OS_APPLE)
+    return (uint64_t)attr.st_mtimespec.tv_sec * 1000000000ULL + (uint64_t)attr.st_mtimespec.tv_nsec;
+#else
+    return (uint64_t)attr.st_mtim.tv_sec * 1000000000ULL + (uint64_t)attr.st_mtim.tv_nsec;
+#endif
 #endif
 }
 
-/* return the most recend library time */
-static uint64_t modlibs(Bd *bd, char *llibs)
+/* cached, since the same headers and libraries get checked over and over */
+static StatEntry *statcache_get(Bd *bd, const char *filename)
+{
+    while(filename[0] == '.' && filename[1] == '/') filename += 2;
+    StatCache *sc = &bd->stats;
+    if(sc->n * 2 >= sc->cap && !statcache_grow(sc)) BD_ERR(bd, 0, "Failed to grow stat cache");
+    StatEntry *entry = statcache_find(sc, filename);
+    if(entry->path && !entry->stale) {
+        sc->hits++;
+        return entry;
+    }
+    sc->misses++;
+    if(!entry->path) {
+        entry->path = path_intern(bd, filename, strlen(filename));
+        if(!entry->path) BD_ERR(bd, 0, "Failed to add '%s' to stat cache", filename);
+        sc->n++;
+    }
+    entry->time = modtime_stat(bd, filename);
+    entry->hashed = false;
+    entry->stale = false;
+    return entry;
+}
+
+static uint64_t modtime(Bd *bd, const char *filename)
+{
+    StatEntry *entry = statcache_get(bd, filename);
+    return entry ? entry->time : 0;
+}
+
+/* XXH64 ; the four independent lanes keep the main loop vectorizable */
+static uint64_t hash_data(const void *data, size_t len)
+{
+    const uint64_t p1 = 0x9E3779B185EBCA87ULL, p2 = 0xC2B2AE3D27D4EB4FULL, p3 = 0x165667B19E3779F9ULL;
+    const uint64_t p4 = 0x85EBCA77C2B2AE63ULL, p5 = 0x27D4EB2F165667C5ULL;
+    #define ROTL64(x,r) (((x) << (r)) | ((x) >> (64 - (r))))
+    #define ROUND64(acc,in) (ROTL64((acc) + (in) * p2, 31) * p1)
+    const uint8_t *p = data;
+    const uint8_t *end = p + len;
+    uint64_t h = 0;
+    if(len >= 32) {
+        uint64_t v[4] = {p1 + p2, p2, 0, -p1};
+        for(; p + 32 <= end; p += 32) {
+            uint64_t in[4];
+            memcpy(in, p, sizeof(in));
+            for(int i = 0; i < 4; i++) v[i] = ROUND64(v[i], in[i]);
+        }
+        h = ROTL64(v[0], 1) + ROTL64(v[1], 7) + ROTL64(v[2], 12) + ROTL64(v[3], 18);
+        for(int i = 0; i < 4; i++) h = ((h ^ ROUND64(0, v[i])) * p1) + p4;
+    } else {
+        h = p5;
+    }
+    h += (uint64_t)len;
+    for(; p + 8 <= end; p += 8) {
+        uint64_t k;
+        memcpy(&k, p, sizeof(k));
+        h ^= ROUND64(0, k);
+        h = ROTL64(h, 27) * p1 + p4;
+    }
+    if(p + 4 <= end) {
+        uint32_t k;
+        memcpy(&k, p, sizeof(k));
+        h ^= (uint64_t)k * p1;
+        h = ROTL64(h, 23) * p2 + p3;
+        p += 4;
+    }
+    for(; p < end; p++) {
+        h ^= (uint64_t)*p * p5;
+        h = ROTL64(h, 11) * p1;
+    }
+    #undef ROUND64
+    #undef ROTL64
+    h ^= h >> 33;
+    h *= p2;
+    h ^= h >> 29;
+    h *= p3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* content hash of a file, 0 if it doesn't exist ; cached alongside its time */
+static uint64_t filehash(Bd *bd, const char *filename)
+{
+    StatEntry *entry = statcache_get(bd, filename);
+    if(!entry || !entry->time) return 0;
+    if(entry->hashed) return entry->hash;
+    size_t size = 0;
+    char *data = read_file(bd, filename, &size);
+    if(!data) BD_ERR(bd, 0, "Could not hash '%s'", filename);
+    entry->hash = hash_data(data, size);
+    if(!entry->hash) entry->hash = 1; /* 0 means unknown */
+    entry->hashed = true;
+    bd->stats.hashed++;
+    free(data);
+    return entry->hash;
+}
+
+/* every static and shared library the linker could pick up from llibs */
+/* a shared library is identified by the symbols it exports, so its users only relink if those changed ;
+ * anything else (or anything that isn't ELF) by its content */
+static uint64_t libhash(Bd *bd, const char *filename)
+{
+    size_t len = strlen(filename), extlen = strlen(static_ext[BUILD_SHARED]);
+    if(len < extlen || strcmp(&filename[len - extlen], static_ext[BUILD_SHARED])) return filehash(bd, filename);
+    size_t size = 0;
+    char *elf = modtime(bd, filename) ? read_file(bd, filename, &size) : 0;
+    uint64_t result = 0;
+    const uint16_t endian = 1;
+    /* only ELF files in our own byte order */
+    if(elf && size >= 64 && !memcmp(elf, "\x7f" "ELF", 4) && elf[5] == (*(char *)&endian ? 1 : 2)) {
+        bool is64 = (elf[4] == 2);
+        #define ELF_U16(p) ((uint16_t)(*(char *)&endian ? ((uint8_t)(p)[0] | (uint8_t)(p)[1] << 8) : ((uint8_t)(p)[0] << 8 | (uint8_t)(p)[1])))
+        #define ELF_OFF(p) (is64 ? deplog_u64(p) : (uint64_t)deplog_u32(p))
+        uint64_t shoff = ELF_OFF(elf + (is64 ? 0x28 : 0x20));
+        uint16_t shentsize = ELF_U16(elf + (is64 ? 0x3A : 0x2E));
+        uint16_t shnum = ELF_U16(elf + (is64 ? 0x3C : 0x30));
+        if(shentsize < (is64 ? 0x40 : 0x28) || shoff > size || (uint64_t)shnum * shentsize > size - shoff) shnum = 0;
+        for(uint16_t i = 0; i < shnum; i++) {
+            char *sh = elf + shoff + (uint64_t)i * shentsize;
+            if(deplog_u32(sh + 4) != 11) continue; /* SHT_DYNSYM */
+            uint64_t off = ELF_OFF(sh + (is64 ? 0x18 : 0x10));
+            uint64_t secsize = ELF_OFF(sh + (is64 ? 0x20 : 0x14));
+            uint32_t link = deplog_u32(sh + (is64 ? 0x28 : 0x18));
+            uint64_t entsize = ELF_OFF(sh + (is64 ? 0x38 : 0x24));
+            if(link >= shnum || entsize < (is64 ? 24u : 16u) || off > size || secsize > size - off) continue;
+            char *strsh = elf + shoff + (uint64_t)link * shentsize;
+            uint64_t stroff = ELF_OFF(strsh + (is64 ? 0x18 : 0x10));
+            uint64_t strsize = ELF_OFF(strsh + (is64 ? 0x20 : 0x14));
+            if(stroff > size || strsize > size - stroff || !strsize || elf[stroff + strsize - 1]) continue;
+            for(uint64_t j = 1; j < secsize / entsize; j++) {
+                char *sym = elf + off + j * entsize;
+                uint32_t name = deplog_u32(sym);
+                uint8_t info = sym[is64 ? 4 : 12], other = sym[is64 ? 5 : 13];
+                uint16_t shndx = ELF_U16(sym + (is64 ? 6 : 14));
+                uint64_t symsize = ELF_OFF(sym + (is64 ? 16 : 8));
+                /* defined global or weak symbols that are visible from the outside */
+                if(!shndx || ((info >> 4) != 1 && (info >> 4) != 2) || ((other & 3) != 0 && (other & 3) != 3) || name >= strsize) continue;
+                /* the size of data is part of the interface, the size of code isn't */
+                char *id = strprf(0, "%s %u %llu", elf + stroff + name, (unsigned)info, (unsigned long long)((info & 0xF) == 1 ? symsize : 0));
+                if(id) result += hash_data(id, strlen(id));
+                free(id);
+            }
+        }
+        #undef ELF_U16
+        #undef ELF_OFF
+    }
+    free(elf);
+    if(!result) return filehash(bd, filename);
+    BD_VERBOSE(bd, "exported symbols of '%s' = %016llx", filename, (unsigned long long)result);
+    return result;
+}
+
+/* what gets logged as the content of a dependency ; shared libraries are always identified, see libhash() */
+static uint64_t dephash(Bd *bd, const char *filename, bool hash)
 {
-    if(!llibs) return 0;
+    size_t len = strlen(filename), extlen = strlen(static_ext[BUILD_SHARED]);
+    bool shared = len >= extlen && !strcmp(&filename[len - extlen], static_ext[BUILD_SHARED]);
+    return shared ? libhash(bd, filename) : hash ? filehash(bd, filename) : 0;
+}
+
+static StrArr *libpaths(Bd *bd, char *llibs)
+{
+    StrArr *result = strarr_new();
+    if(!result) BD_ERR(bd, 0, "Failed to create StrArr");
+    if(!llibs) return result;
     int llibs_len = strlen(llibs);
     /* extract paths / names from llibs */
     char *find[] = {"-L", "-l"};
     StrArr *arr_Ll[] = {strarr_new(), strarr_new()};
-    for(int i = 0; i < (int)SIZE_ARRAY(arr_Ll); i++) {
-        if(!arr_Ll[i]) BD_ERR(bd, 0, "Failed to create StrArr");
+    bool ok = arr_Ll[0] && arr_Ll[1];
+    for(int i = 0; i < (int)SIZE_ARRAY(arr_Ll) && ok; i++) {
         char *search = llibs;
-        while(*search) {
+        while(*search && ok) {
             search = strstr(search, find[i]);
             if(!search) break;
             search += strlen(find[i]) + 1;
             char *space = memchr(search, ' ', llibs + llibs_len - search);
-            space = space ? space : search + llibs_len;
-            if(!strarr_set_n(arr_Ll[i], arr_Ll[i]->n + 1)) BD_ERR(bd, 0, "Failed to modify StrArr");
-            arr_Ll[i]->s[arr_Ll[i]->n - 1] = strprf(0, "%.*s", (int)(space - search), search);
-            search = space + 1;
+            space = space ? space : llibs + llibs_len;
+            ok = strarr_push(bd, arr_Ll[i], path_intern(bd, search, space - search));
+            search = *space ? space + 1 : space;
         }
     }
-    /* finally get the most recent modified time */
-    uint64_t recent = 0;
-    for(int i = 0; i < arr_Ll[0]->n; i++) {
-        for(int j = 0; j < arr_Ll[1]->n; j++) {
-            char *libstatic = strprf(0, "%s%slib%s%s", arr_Ll[0]->s[i], SLASH_STR, arr_Ll[1]->s[j], static_ext[BUILD_STATIC]);
-            char *libshared = strprf(0, "%s%slib%s%s", arr_Ll[0]->s[i], SLASH_STR, arr_Ll[1]->s[j], static_ext[BUILD_SHARED]);
-            uint64_t modstatic = modtime(bd, libstatic);
-            uint64_t modshared = modtime(bd, libshared);
-            BD_VERBOSE(bd, "modified time of static library '%s' : %zu", libstatic, (size_t)modstatic);
-            BD_VERBOSE(bd, "modified time of shared library '%s' : %zu", libshared, (size_t)modshared);
-            recent = modstatic > recent ? modstatic : recent;
-            recent = modshared > recent ? modshared : recent;
-        }
-    }
-    /* free all used arrs */
+    for(int i = 0; ok && i < arr_Ll[0]->n; i++) {
+        for(int j = 0; ok && j < arr_Ll[1]->n; j++) {
+            ok = strarr_push(bd, result, path_prf(bd, "%s%slib%s%s", arr_Ll[0]->s[i], SLASH_STR, arr_Ll[1]->s[j], static_ext[BUILD_STATIC]))
+                && strarr_push(bd, result, path_prf(bd, "%s%slib%s%s", arr_Ll[0]->s[i], SLASH_STR, arr_Ll[1]->s[j], static_ext[BUILD_SHARED]));
+        }
+    }
+    /* free all used arrs, whether it worked or not */
     for(int i = 0; i < (int)SIZE_ARRAY(arr_Ll); i++) {
         strarr_free_p(arr_Ll[i]);
     }
+    if(!ok) {
+        strarr_free_p(result);
+        BD_ERR(bd, 0, "Failed to list the libraries in '%s'", llibs);
+    }
+    return result;
+}
+
+/* return the most recend library time */
+static uint64_t modlibs(Bd *bd, char *llibs)
+{
+    StrArr *libs = libpaths(bd, llibs);
+    if(!libs) return 0;
+    uint64_t recent = 0;
+    for(int i = 0; i < libs->n; i++) {
+        uint64_t modlib = modtime(bd, libs->s[i]);
+        BD_VERBOSE(bd, "modified time of library '%s' : %zu", libs->s[i], (size_t)modlib);
+        recent = modlib > recent ? modlib : recent;
+    }
+    strarr_free_p(libs);
     return recent;
 }
 
@@ -520,75 +1465,1707 @@ static void makedir(const char *dirname)
 #endif
 }
 
-static StrArr *extract_dirs(Bd *bd, char *path, bool skiplast)
+static const char static_deplog_magic[8] = "BDDEPS4";
+static const uint32_t static_deplog_endian = 0x01020304;
+
+static DepLog *deplog_get(Bd *bd, char *objd)
 {
-    StrArr *result = strarr_new();
-    /* go over the given path and split by '/' */
-    int len = path ? strlen(path) : 0;
-    for(int i = 0; i < len; i++) {
-        bool mkd = false;
-        if(path[i] == '/') mkd = true;
-        else if(i + 1 == len && !skiplast) mkd = true;
-        if(mkd) {
-            if(!strarr_set_n(result, result->n + 1)) BD_ERR(bd, 0, "Failed to modify StrArr");
-            result->s[result->n - 1] = strprf(0, "%.*s", i + 1, path);
-        }
+    for(DepLog *log = bd->logs; log; log = log->next) {
+        if((!log->objd && !objd) || (log->objd && objd && !strcmp(log->objd, objd))) return log;
     }
-    return result;
+    DepLog *log = calloc(1, sizeof(*log));
+    if(!log) BD_ERR(bd, 0, "Failed to create dependency log");
+    log->objd = objd ? strprf(0, "%s", objd) : 0;
+    log->path = strprf(0, "%s%s.bd.deps", objd ? objd : "", objd ? SLASH_STR : "");
+    log->next = bd->logs;
+    bd->logs = log;
+    double t = timer_now();
+    deplog_load(bd, log);
+    trace(bd, "deps", log->path, t, 0, 0, 0);
+    return log;
 }
 
-static void compile(Bd *bd, Prj *p, char *name, char *objf, char *srcf)
+static uint32_t deplog_u32(const char *p)
 {
-    char *cc = static_cc_cxx(bd, p, objf, srcf);
-    if(!strarr_set_n(&bd->ofiles, bd->ofiles.n + 1)) BD_ERR(bd,, "Failed to modify StrArr");
-    bd->ofiles.s[bd->ofiles.n - 1] = strprf(bd->ofiles.s[bd->ofiles.n - 1], objf);
-    BD_MSG(bd, "\033[94;1m[ %s ]\033[0m %s", name, cc); /* bright blue color */
-    bd->error = system(cc);
-    free(cc);
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
 }
 
-static void verify_cc_cxx(Bd *bd, Prj *p, char *filename)
+static uint64_t deplog_u64(const char *p)
 {
-    char *cc_use = 0;
-    size_t filename_len = strlen(filename);
-    if(strrstr(filename, ".c") == filename_len - 2) {
-        cc_use = p->cc ? p->cc : static_cc_def;
-        if(!bd->use_cxx) bd->cc_cxx = cc_use;
-    }
-    if(strrstr(filename, ".cc") == filename_len - 3 || strrstr(filename, ".cpp") == filename_len - 4) {
-        cc_use = p->cxx ? p->cxx : static_cxx_def;
-        bd->cc_cxx = cc_use;
-        bd->use_cxx = true;
-    }
-    if(!cc_use) BD_ERR(bd,, "Unsupported file extension");
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
 }
 
-static void link(Bd *bd, Prj *p, char *name, bool avoidlink)
+/* the log is a sequence of records:
+ *  'S' u32 len, len bytes : string including its terminating 0, gets the next id
+ *  'O' u32 key, u32 n, n * (u32 file, u64 mtime, u64 hash) : what an object or target was built from, later ones win
+ *  'C' u32 key, u64 sig : hash of the command an object or target was built with, later ones win
+ *  'T' u32 key, u32 ms : how long building an object or target took last time, later ones win
+ * the hash is 0 if it wasn't computed */
+static void deplog_load(Bd *bd, DepLog *log)
 {
-    if(bd->error) return;
-    if(bd->ofiles.n && !avoidlink) {
-        /* link */
-        char *ofiles = 0;
-        for(int i = 0; i < bd->ofiles.n; i++) ofiles = strprf(ofiles, "%s%s", bd->ofiles.s[i], i + 1 < bd->ofiles.n ? " " : "");
-        char *ld = static_ld(bd, p, name, ofiles, p->llibs);
-        BD_MSG(bd, "\033[93;1m[ %s ]\033[0m %s", name, ld); /* bright yellow color*/
-        bd->error = system(ld);
-        free(ofiles);
-        free(ld);
-    } else {
-        BD_MSG(bd, "\033[92;1m[ %s ]\033[0m is up to date", name); /* bright green color */
+#if defined(OS_WIN)
+    FILE *fp = fopen(log->path, "rb");
+    if(fp) {
+        fseek(fp, 0, SEEK_END);
+        long size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        log->map = size > 0 ? malloc(size) : 0;
+        if(log->map && fread(log->map, 1, size, fp) == (size_t)size) log->size = size;
+        fclose(fp);
     }
-    bd->cc_cxx = static_cc_def;
-    bd->use_cxx = false;
-    strarr_free(&bd->ofiles);
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    FILE *fp = fopen(log->path, "rb");
+    if(fp) {
+        struct stat attr = {0};
+        if(!fstat(fileno(fp), &attr) && attr.st_size > 0) {
+            void *map = mmap(0, attr.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+            if(map != MAP_FAILED) {
+                log->map = map;
+                log->size = attr.st_size;
+            }
+        }
+        fclose(fp);
+    }
+#endif
+    size_t head = sizeof(static_deplog_magic) + sizeof(static_deplog_endian);
+    if(log->size < head || memcmp(log->map, static_deplog_magic, sizeof(static_deplog_magic))
+            || deplog_u32(log->map + sizeof(static_deplog_magic)) != static_deplog_endian) {
+        log->rewrite = true;
+        return;
+    }
+    size_t pos = head;
+    while(pos < log->size && !bd->error) {
+        char *rec = log->map + pos;
+        size_t left = log->size - pos;
+        if(*rec == 'S' && left >= 5) {
+            uint32_t len = deplog_u32(rec + 1);
+            if(!len || left - 5 < len || rec[5 + len - 1]) break;
+            deplog_intern(bd, log, rec + 5, false);
+            pos += 5 + len;
+        } else if(*rec == 'O' && left >= 9) {
+            uint32_t obj = deplog_u32(rec + 1);
+            uint32_t n = deplog_u32(rec + 5);
+            if(obj >= log->nstr || (left - 9) / DEPLOG_ENT < n) break;
+            bool valid = true;
+            for(uint32_t i = 0; i < n && valid; i++) valid = (deplog_u32(rec + 9 + i * DEPLOG_ENT) < log->nstr);
+            if(!valid) break;
+            if(!log->obj[obj].known) log->live++;
+            log->obj[obj] = (DepObj){.ents = (uint8_t *)rec + 9, .n = n, .sig = log->obj[obj].sig, .ms = log->obj[obj].ms, .known = true};
+            log->records++;
+            pos += 9 + (size_t)n * DEPLOG_ENT;
+        } else if(*rec == 'C' && left >= 13) {
+            uint32_t obj = deplog_u32(rec + 1);
+            if(obj >= log->nstr) break;
+            log->obj[obj].sig = deplog_u64(rec + 5);
+            pos += 13;
+        } else if(*rec == 'T' && left >= 9) {
+            uint32_t obj = deplog_u32(rec + 1);
+            if(obj >= log->nstr) break;
+            log->obj[obj].ms = deplog_u32(rec + 5);
+            pos += 9;
+        } else {
+            break;
+        }
+    }
+    /* a damaged tail (e.g. bd got killed) makes us write it anew */
+    if(pos < log->size) log->rewrite = true;
+    log->strfile = log->nstr;
+    BD_VERBOSE(bd, "loaded %u objects and %u strings from '%s'", log->live, log->nstr, log->path);
 }
 
-static void build(Bd *bd, Prj *p)
+static bool deplog_reserve(DepLog *log, uint32_t n)
 {
-    if(!bd) return;
+    if(n > log->cap) {
+        uint32_t cap = log->cap ? log->cap : 64;
+        while(cap < n) cap *= 2;
+        void *str = realloc(log->str, sizeof(*log->str) * cap);
+        if(!str) return false;
+        log->str = str;
+        void *obj = realloc(log->obj, sizeof(*log->obj) * cap);
+        if(!obj) return false;
+        log->obj = obj;
+        memset(&log->obj[log->cap], 0, sizeof(*log->obj) * (cap - log->cap));
+        log->cap = cap;
+    }
+    if(n * 2 > log->capindex) {
+        uint32_t capindex = log->capindex ? log->capindex : 128;
+        while(n * 2 > capindex) capindex *= 2;
+        uint32_t *index = calloc(capindex, sizeof(*index));
+        if(!index) return false;
+        for(uint32_t i = 0; i < log->nstr; i++) {
+            uint32_t j = strhash(log->str[i]) & (capindex - 1);
+            while(index[j]) j = (j + 1) & (capindex - 1);
+            index[j] = i + 1;
+        }
+        free(log->index);
+        log->index = index;
+        log->capindex = capindex;
+    }
+    return true;
+}
+
+/* returns UINT32_MAX if the string isn't known */
+static uint32_t deplog_find(DepLog *log, const char *s)
+{
+    if(!log->capindex) return UINT32_MAX;
+    uint32_t mask = log->capindex - 1;
+    for(uint32_t j = strhash(s) & mask; log->index[j]; j = (j + 1) & mask) {
+        if(!strcmp(log->str[log->index[j] - 1], s)) return log->index[j] - 1;
+    }
+    return UINT32_MAX;
+}
+
+static uint32_t deplog_intern(Bd *bd, DepLog *log, const char *s, bool copy)
+{
+    while(s[0] == '.' && s[1] == '/') s += 2;
+    uint32_t id = deplog_find(log, s);
+    if(id != UINT32_MAX) return id;
+    if(!deplog_reserve(log, log->nstr + 1)) BD_ERR(bd, UINT32_MAX, "Failed to grow dependency log");
+    id = log->nstr;
+    log->str[id] = copy ? path_intern(bd, s, strlen(s)) : (char *)s;
+    if(!log->str[id]) BD_ERR(bd, UINT32_MAX, "Failed to add string to dependency log");
+    log->nstr++;
+    uint32_t mask = log->capindex - 1;
+    uint32_t j = strhash(log->str[id]) & mask;
+    while(log->index[j]) j = (j + 1) & mask;
+    log->index[j] = id + 1;
+    return id;
+}
+
+/* remember the current state of the files `key` was built from */
+static void deplog_record(Bd *bd, DepLog *log, char *key, char **files, int n, bool hash)
+{
+    uint32_t id = deplog_intern(bd, log, key, true);
+    if(id == UINT32_MAX) return;
+    uint8_t *ents = n ? malloc((size_t)n * DEPLOG_ENT) : 0;
+    if(n && !ents) BD_ERR(bd,, "Failed to allocate dependencies");
+    for(int i = 0; i < n && !bd->error; i++) {
+        uint32_t file = deplog_intern(bd, log, files[i], true);
+        uint64_t time = modtime(bd, files[i]);
+        uint64_t content = dephash(bd, files[i], hash);
+        memcpy(ents + i * DEPLOG_ENT, &file, sizeof(file));
+        memcpy(ents + i * DEPLOG_ENT + 4, &time, sizeof(time));
+        memcpy(ents + i * DEPLOG_ENT + 12, &content, sizeof(content));
+    }
+    DepObj *o = &log->obj[id];
+    if(o->owned) free(o->ents);
+    if(!o->known) log->live++;
+    *o = (DepObj){.ents = ents, .n = n, .sig = o->sig, .ms = o->ms, .known = true, .dirty = true, .owned = true};
+    log->dirty = true;
+    BD_VERBOSE(bd, "logged %d dependencies of '%s'", n, key);
+}
+
+/* read the dependency file the compiler wrote and remember it along with the source */
+static void deplog_ingest(Bd *bd, DepLog *log, char *objf, char *srcf, char *depf, bool hash)
+{
+    double t = timer_now();
+    DepFile *hdrfs = parse_dfile(bd, depf);
+    trace(bd, "parse", depf, t, 0, 0, 0);
+    int n = hdrfs ? hdrfs->n : 0;
+    char **files = malloc(sizeof(*files) * (n + 1));
+    if(!files) BD_ERR(bd,, "Failed to allocate dependencies");
+    files[0] = srcf;
+    for(int i = 0; i < n; i++) files[i + 1] = hdrfs->s[i];
+    deplog_record(bd, log, objf, files, n + 1, hash);
+    free(files);
+    depfile_free(hdrfs);
+}
+
+/* 1 if any file `key` was built from changed, 0 if not, -1 if nothing is logged
+ * without hashing a file changed if its time differs or is newer than `m_key` ;
+ * with hashing a file only changed if both its time and its content differ */
+static int deplog_check(Bd *bd, DepLog *log, char *key, uint64_t m_key, bool hash)
+{
+    while(key[0] == '.' && key[1] == '/') key += 2;
+    uint32_t id = deplog_find(log, key);
+    if(id == UINT32_MAX || !log->obj[id].known) return -1;
+    DepObj *o = &log->obj[id];
+    for(uint32_t i = 0; i < o->n && !bd->error; i++) {
+        char *file = log->str[deplog_u32((char *)o->ents + i * DEPLOG_ENT)];
+        uint64_t m_logged = deplog_u64((char *)o->ents + i * DEPLOG_ENT + 4);
+        uint64_t h_logged = deplog_u64((char *)o->ents + i * DEPLOG_ENT + 12);
+        uint64_t m_file = modtime(bd, file);
+        BD_VERBOSE(bd, "modified time of dependency '%s' = %zu", file, (size_t)m_file);
+        if(!hash) {
+            if(m_file != m_logged || m_file > m_key) return 1;
+            continue;
+        }
+        if(m_file == m_logged) continue;
+        if(!h_logged || dephash(bd, file, true) != h_logged) return 1;
+        /* only touched ; remember the new time so it doesn't get hashed again */
+        BD_VERBOSE(bd, "content of '%s' didn't change", file);
+        if(!o->owned) {
+            uint8_t *ents = malloc((size_t)o->n * DEPLOG_ENT);
+            if(!ents) BD_ERR(bd, 1, "Failed to allocate dependencies");
+            memcpy(ents, o->ents, (size_t)o->n * DEPLOG_ENT);
+            o->ents = ents;
+            o->owned = true;
+        }
+        memcpy(o->ents + i * DEPLOG_ENT + 4, &m_file, sizeof(m_file));
+        o->dirty = true;
+        log->dirty = true;
+    }
+    return 0;
+}
+
+/* remember the command `key` was built with */
+static void deplog_sign(Bd *bd, DepLog *log, char *key, uint64_t sig)
+{
+    uint32_t id = deplog_intern(bd, log, key, true);
+    if(id == UINT32_MAX || log->obj[id].sig == sig) return;
+    log->obj[id].sig = sig;
+    log->obj[id].dirty = true;
+    log->dirty = true;
+}
+
+/* false if `key` was built with a different command ; one that wasn't logged yet is taken as is */
+static bool deplog_signed(Bd *bd, DepLog *log, char *key, uint64_t sig)
+{
+    while(key[0] == '.' && key[1] == '/') key += 2;
+    uint32_t id = deplog_find(log, key);
+    if(id != UINT32_MAX && log->obj[id].sig && log->obj[id].sig != sig) {
+        BD_VERBOSE(bd, "command of '%s' changed", key);
+        return false;
+    }
+    if(id == UINT32_MAX || !log->obj[id].sig) deplog_sign(bd, log, key, sig);
+    return true;
+}
+
+/* remember how long building `key` took */
+static void deplog_time(Bd *bd, DepLog *log, char *key, double seconds)
+{
+    uint32_t id = deplog_intern(bd, log, key, true);
+    /* 0 is unknown, so anything quicker is a millisecond */
+    uint32_t ms = seconds < 0.001 ? 1 : seconds > 4e6 ? UINT32_MAX : (uint32_t)(seconds * 1e3);
+    if(id == UINT32_MAX || log->obj[id].ms == ms) return;
+    log->obj[id].ms = ms;
+    log->obj[id].dirty = true;
+    log->dirty = true;
+}
+
+/* how many seconds building `key` took last time, 0 if unknown */
+static double deplog_took(DepLog *log, char *key)
+{
+    uint32_t id = log ? deplog_find(log, key) : UINT32_MAX;
+    return id == UINT32_MAX ? 0 : (double)log->obj[id].ms * 1e-3;
+}
+
+/* write the whole log anew ; compacting drops strings that aren't used anymore */
+static bool deplog_write(Bd *bd, DepLog *log, bool compact)
+{
+    char *tmp = strprf(0, "%s.tmp", log->path);
+    FILE *fp = fopen(tmp, "wb");
+    uint32_t *remap = malloc(sizeof(*remap) * (log->nstr + 1));
+    if(!fp || !remap) {
+        if(fp) fclose(fp);
+        free(remap);
+        free(tmp);
+        BD_ERR(bd, false, "Could not write '%s'", log->path);
+    }
+    fwrite(static_deplog_magic, 1, sizeof(static_deplog_magic), fp);
+    fwrite(&static_deplog_endian, sizeof(static_deplog_endian), 1, fp);
+    uint32_t nstr = 0;
+    for(uint32_t i = 0; i < log->nstr; i++) remap[i] = compact ? UINT32_MAX : i;
+    if(!compact) {
+        for(uint32_t i = 0; i < log->nstr; i++) {
+            uint32_t len = strlen(log->str[i]) + 1;
+            fputc('S', fp);
+            fwrite(&len, sizeof(len), 1, fp);
+            fwrite(log->str[i], 1, len, fp);
+        }
+        nstr = log->nstr;
+    }
+    uint32_t records = 0;
+    for(uint32_t i = 0; i < log->nstr; i++) {
+        DepObj *o = &log->obj[i];
+        if(!o->known && !o->sig && !o->ms) continue;
+        /* strings have to precede the records that use them */
+        for(uint32_t j = 0; j <= o->n; j++) {
+            uint32_t id = j < o->n ? deplog_u32((char *)o->ents + j * DEPLOG_ENT) : i;
+            if(remap[id] != UINT32_MAX) continue;
+            uint32_t len = strlen(log->str[id]) + 1;
+            fputc('S', fp);
+            fwrite(&len, sizeof(len), 1, fp);
+            fwrite(log->str[id], 1, len, fp);
+            remap[id] = nstr++;
+        }
+        if(o->sig) {
+            fputc('C', fp);
+            fwrite(&remap[i], sizeof(remap[i]), 1, fp);
+            fwrite(&o->sig, sizeof(o->sig), 1, fp);
+        }
+        if(o->ms) {
+            fputc('T', fp);
+            fwrite(&remap[i], sizeof(remap[i]), 1, fp);
+            fwrite(&o->ms, sizeof(o->ms), 1, fp);
+        }
+        o->dirty = false;
+        if(!o->known) continue;
+        fputc('O', fp);
+        fwrite(&remap[i], sizeof(remap[i]), 1, fp);
+        fwrite(&o->n, sizeof(o->n), 1, fp);
+        for(uint32_t j = 0; j < o->n; j++) {
+            fwrite(&remap[deplog_u32((char *)o->ents + j * DEPLOG_ENT)], sizeof(uint32_t), 1, fp);
+            fwrite(o->ents + j * DEPLOG_ENT + 4, sizeof(uint64_t) * 2, 1, fp);
+        }
+        records++;
+    }
+    bool ok = !ferror(fp);
+    if(fclose(fp)) ok = false;
+#if defined(OS_WIN)
+    if(ok) remove(log->path);
+#endif
+    if(ok && rename(tmp, log->path)) ok = false;
+    if(!ok) remove(tmp);
+    BD_VERBOSE(bd, "wrote %u objects and %u strings to '%s'", records, nstr, log->path);
+    free(remap);
+    free(tmp);
+    log->records = records;
+    log->strfile = log->nstr;
+    log->rewrite = false;
+    log->dirty = false;
+    if(!ok) BD_ERR(bd, false, "Could not write '%s'", log->path);
+    return true;
+}
+
+/* append whatever is new ; the final flush also compacts the log once it's mostly outdated records */
+static void deplog_flush(Bd *bd, DepLog *log, bool final)
+{
+    if(!log) return;
+    if(final && log->records > 2 * log->live + 64) {
+        deplog_write(bd, log, true);
+        return;
+    }
+    if(!log->dirty) return;
+    if(log->rewrite || !modtime_stat(bd, log->path)) {
+        deplog_write(bd, log, false);
+        return;
+    }
+    FILE *fp = fopen(log->path, "ab");
+    if(!fp) BD_ERR(bd,, "Could not open '%s'", log->path);
+    for(uint32_t i = log->strfile; i < log->nstr; i++) {
+        uint32_t len = strlen(log->str[i]) + 1;
+        fputc('S', fp);
+        fwrite(&len, sizeof(len), 1, fp);
+        fwrite(log->str[i], 1, len, fp);
+    }
+    log->strfile = log->nstr;
+    for(uint32_t i = 0; i < log->nstr; i++) {
+        DepObj *o = &log->obj[i];
+        if(!o->dirty) continue;
+        o->dirty = false;
+        if(o->sig) {
+            fputc('C', fp);
+            fwrite(&i, sizeof(i), 1, fp);
+            fwrite(&o->sig, sizeof(o->sig), 1, fp);
+        }
+        if(o->ms) {
+            fputc('T', fp);
+            fwrite(&i, sizeof(i), 1, fp);
+            fwrite(&o->ms, sizeof(o->ms), 1, fp);
+        }
+        if(!o->known) continue;
+        fputc('O', fp);
+        fwrite(&i, sizeof(i), 1, fp);
+        fwrite(&o->n, sizeof(o->n), 1, fp);
+        if(o->n) fwrite(o->ents, DEPLOG_ENT, o->n, fp);
+        log->records++;
+    }
+    log->dirty = false;
+    if(fclose(fp)) BD_ERR(bd,, "Could not write '%s'", log->path);
+}
+
+static void deplog_free(DepLog *log)
+{
+    if(!log) return;
+    for(uint32_t i = 0; i < log->nstr; i++) {
+        if(log->obj[i].owned) free(log->obj[i].ents);
+    }
+#if defined(OS_WIN)
+    free(log->map);
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    if(log->map) munmap(log->map, log->size);
+#endif
+    free(log->str);
+    free(log->obj);
+    free(log->index);
+    free(log->path);
+    free(log->objd);
+    free(log);
+}
+
+/* forget a log, e.g. because its file got deleted */
+static void deplog_drop(Bd *bd, char *objd)
+{
+    DepLog *log = deplog_get(bd, objd);
+    for(DepLog **prev = &bd->logs; *prev; prev = &(*prev)->next) {
+        if(*prev != log) continue;
+        *prev = log->next;
+        deplog_free(log);
+        break;
+    }
+}
+
+/* a name next to `path` to write to before renaming it to `path`, not used by any other process */
+static char *tmp_path(const char *path)
+{
+    static unsigned count = 0;
+#if defined(OS_WIN)
+    unsigned long pid = GetCurrentProcessId();
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    unsigned long pid = getpid();
+#endif
+    return strprf(0, "%s.%lu-%u.tmp", path, pid, count++);
+}
+
+/* copies into a temporary file that gets renamed, so others sharing the folder (e.g. the object cache) never see
+ * half of it */
+static bool copy_file(const char *from, const char *to)
+{
+    char *tmp = tmp_path(to);
+    FILE *in = tmp ? fopen(from, "rb") : 0;
+    FILE *out = in ? fopen(tmp, "wb") : 0;
+    if(!out) {
+        if(in) fclose(in);
+        free(tmp);
+        return false;
+    }
+    char buf[1 << 16];
+    size_t len;
+    bool ok = true;
+    while((len = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if(fwrite(buf, 1, len, out) != len) {
+            ok = false;
+            break;
+        }
+    }
+    if(ferror(in)) ok = false;
+    fclose(in);
+    if(fclose(out)) ok = false;
+#if defined(OS_WIN)
+    if(ok) remove(to);
+#endif
+    if(ok && rename(tmp, to)) ok = false;
+    if(!ok) remove(tmp);
+    free(tmp);
+    return ok;
+}
+
+/* identify a compiler by the content of its executable as found in PATH */
+static uint64_t compiler_id(Bd *bd, char *cc)
+{
+    if(strchr(cc, '/') || strchr(cc, '\\')) return filehash(bd, cc);
+    char *path = getenv("PATH");
+    while(path && *path) {
+        char *sep = strchr(path, OS_PATHSEP);
+        int len = sep ? (int)(sep - path) : (int)strlen(path);
+        char *exe = strprf(0, "%.*s%s%s%s", len, path, len ? SLASH_STR : "", cc, static_ext[BUILD_APP]);
+        uint64_t id = modtime(bd, exe) ? filehash(bd, exe) : 0;
+        free(exe);
+        if(id) return id;
+        path = sep ? sep + 1 : 0;
+    }
+    return hash_data(cc, strlen(cc));
+}
+
+/* cache entries are spread over 256 sub folders */
+static char *cache_path(Bd *bd, uint64_t key, const char *ext, bool create)
+{
+    char *dir = strprf(0, "%s%s%02x", bd->cache, SLASH_STR, (unsigned)(key >> 56));
+    if(create) {
+        StrArr *dirs = extract_dirs(bd, dir, false);
+        for(int i = 0; dirs && i < dirs->n; i++) makedir(dirs->s[i]);
+        strarr_free_p(dirs);
+    }
+    char *result = strprf(0, "%s%s%016llx%s", dir, SLASH_STR, (unsigned long long)key, ext);
+    free(dir);
+    return result;
+}
+
+/* everything that's known before compiling: compiler, full command and source */
+static uint64_t cache_direct(Bd *bd, char *cmd, char *srcf, char *pchf)
+{
+    /* the headers in a precompiled one don't show up in the dependency file, so it counts as part of the source */
+    char *key = strprf(0, "cc %016llx\ncmd %s\nsrc %016llx\npch %016llx\n", (unsigned long long)compiler_id(bd, bd->cc_cxx), cmd, (unsigned long long)filehash(bd, srcf), (unsigned long long)(pchf ? filehash(bd, pchf) : 0));
+    if(!key) return 0;
+    uint64_t result = hash_data(key, strlen(key));
+    free(key);
+    return result;
+}
+
+/* the manifest of a direct key lists results and the header hashes they were compiled with:
+ *  <result key> <number of headers>
+ *  <header hash> <header path>    (once per header) */
+static bool cache_restore(Bd *bd, uint64_t direct, char *objf, char *depf)
+{
+    char *manifest = cache_path(bd, direct, ".m", false);
+    FILE *fp = fopen(manifest, "rb");
+    free(manifest);
+    if(!fp) return false;
+    unsigned long long result = 0;
+    int n = 0;
+    char line[4096];
+    bool found = false;
+    while(!found && fgets(line, sizeof(line), fp)) {
+        if(sscanf(line, "%llx %d", &result, &n) != 2) break;
+        found = true;
+        for(int i = 0; i < n; i++) {
+            unsigned long long hash = 0;
+            char hdrf[4096];
+            if(!fgets(line, sizeof(line), fp) || sscanf(line, "%llx %4095s", &hash, hdrf) != 2) {
+                found = false;
+                n = 0;
+                break;
+            }
+            if(found && filehash(bd, hdrf) != hash) found = false;
+        }
+    }
+    fclose(fp);
+    if(!found) return false;
+    char *cobjf = cache_path(bd, result, ".o", false);
+    char *cdepf = cache_path(bd, result, ".d", false);
+    bool ok = modtime_stat(bd, cobjf) && modtime_stat(bd, cdepf) && copy_file(cdepf, depf) && copy_file(cobjf, objf);
+#if defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    /* most recently used entries are kept the longest */
+    if(ok) {
+        utime(cobjf, 0);
+        utime(cdepf, 0);
+    }
+#endif
+    BD_VERBOSE(bd, "restored '%s' from cache entry %016llx : %s", objf, result, ok ? "ok" : "failed");
+    free(cobjf);
+    free(cdepf);
+    return ok;
+}
+
+/* the object was just compiled and its dependencies logged */
+static void cache_store(Bd *bd, uint64_t direct, DepLog *log, char *objf, char *depf)
+{
+    while(objf[0] == '.' && objf[1] == '/') objf += 2;
+    uint32_t id = deplog_find(log, objf);
+    if(id == UINT32_MAX || !log->obj[id].known) return;
+    DepObj *o = &log->obj[id];
+    /* the source is already part of the direct key */
+    char *entry = strprf(0, "%u\n", o->n ? o->n - 1 : 0);
+    for(uint32_t i = 1; i < o->n && entry; i++) {
+        char *hdrf = log->str[deplog_u32((char *)o->ents + i * DEPLOG_ENT)];
+        entry = strprf(entry, "%016llx %s\n", (unsigned long long)filehash(bd, hdrf), hdrf);
+    }
+    if(!entry) BD_ERR(bd,, "Failed to create cache entry");
+    char *keystr = strprf(0, "%016llx\n%s", (unsigned long long)direct, entry);
+    uint64_t result = keystr ? hash_data(keystr, strlen(keystr)) : 0;
+    free(keystr);
+    char *cobjf = cache_path(bd, result, ".o", true);
+    char *cdepf = cache_path(bd, result, ".d", true);
+    char *manifest = cache_path(bd, direct, ".m", true);
+    char *line = strprf(0, "%016llx %s", (unsigned long long)result, entry);
+    if(line && copy_file(objf, cobjf) && copy_file(depf, cdepf)) {
+        /* only now that the entry is complete, in one write so lines of builds sharing the cache don't mix.
+         * don't let the manifest grow forever, the newest results are the likeliest to match */
+        struct stat attr = {0};
+        bool append = !stat(manifest, &attr) && attr.st_size < (1 << 16);
+        size_t len = strlen(line);
+        bool ok = false;
+        if(append) {
+#if defined(OS_WIN)
+            FILE *fp = fopen(manifest, "ab");
+            ok = fp && fwrite(line, 1, len, fp) == len;
+            if(fp && fclose(fp)) ok = false;
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+            int fd = open(manifest, O_WRONLY | O_APPEND | O_CREAT, 0644);
+            ok = fd != -1 && write(fd, line, len) == (ssize_t)len;
+            if(fd != -1 && close(fd)) ok = false;
+#endif
+        } else {
+            /* start over with a new one in its place */
+            char *tmp = tmp_path(manifest);
+            FILE *fp = tmp ? fopen(tmp, "wb") : 0;
+            ok = fp && fwrite(line, 1, len, fp) == len;
+            if(fp && fclose(fp)) ok = false;
+#if defined(OS_WIN)
+            if(ok) remove(manifest);
+#endif
+            if(ok && rename(tmp, manifest)) ok = false;
+            if(!ok && tmp) remove(tmp);
+            free(tmp);
+        }
+        if(!ok) BD_VERBOSE(bd, "could not add cache entry %016llx to '%s'", (unsigned long long)result, manifest);
+        bd->cachestored++;
+        BD_VERBOSE(bd, "stored '%s' as cache entry %016llx", objf, (unsigned long long)result);
+    }
+    free(line);
+    free(manifest);
+    free(cobjf);
+    free(cdepf);
+    free(entry);
+}
+
+typedef struct CacheFile {
+    char *path;
+    uint64_t size;
+    uint64_t time;
+} CacheFile;
+
+static int cachefile_cmp(const void *a, const void *b)
+{
+    uint64_t ta = ((CacheFile *)a)->time, tb = ((CacheFile *)b)->time;
+    return ta < tb ? -1 : ta > tb;
+}
+
+/* remove the least recently used entries until the cache is within its limit again */
+static void cache_trim(Bd *bd)
+{
+    if(!bd->cache || !bd->cachestored) return;
+    uint64_t max = bd->cachemax ? bd->cachemax : (uint64_t)5120 << 20;
+    CacheFile *files = 0;
+    size_t n = 0, cap = 0;
+    uint64_t total = 0;
+    for(int k = 0; k < 256; k++) {
+        char *dir = strprf(0, "%s%s%02x", bd->cache, SLASH_STR, k);
+        DIR *dp = opendir(dir);
+        struct dirent *entry;
+        while(dp && (entry = readdir(dp))) {
+            if(entry->d_name[0] == '.') continue;
+            char *path = strprf(0, "%s%s%s", dir, SLASH_STR, entry->d_name);
+            struct stat attr = {0};
+            if(stat(path, &attr) || !S_ISREG(attr.st_mode)) {
+                free(path);
+                continue;
+            }
+            if(n == cap) {
+                cap = cap ? cap * 2 : 1024;
+                void *temp = realloc(files, sizeof(*files) * cap);
+                if(!temp) {
+                    free(path);
+                    break;
+                }
+                files = temp;
+            }
+            files[n++] = (CacheFile){.path = path, .size = attr.st_size, .time = attr.st_mtime};
+            total += attr.st_size;
+        }
+        if(dp) closedir(dp);
+        free(dir);
+    }
+    BD_VERBOSE(bd, "object cache holds %zu files, %llu of %llu bytes", n, (unsigned long long)total, (unsigned long long)max);
+    if(total > max) {
+        qsort(files, n, sizeof(*files), cachefile_cmp);
+        for(size_t i = 0; i < n && total > max - max / 10; i++) {
+            if(!remove(files[i].path)) total -= files[i].size;
+        }
+    }
+    for(size_t i = 0; i < n; i++) free(files[i].path);
+    free(files);
+}
+
+static int cpu_count(void)
+{
+#if defined(OS_WIN)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+/* share the jobs with the make that started bd (MAKEFLAGS has --jobserver-auth=R,W or =fifo:PATH),
+ * or be the jobserver for the compilers, linkers and makes bd starts itself */
+static void jobserver_init(Bd *bd)
+{
+#if defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    if(bd->jsinit) return;
+    bd->jsinit = true;
+    char *flags = getenv("MAKEFLAGS");
+    char *auth = 0;
+    int makejobs = 0;
+    /* make puts -j first if there are no other flags */
+    for(char *f = flags; f && (f = strstr(f, "-j")); f++) {
+        if(f == flags || f[-1] == ' ' || f[-1] == '\t') sscanf(f, "-j%d", &makejobs);
+    }
+    for(char *f = flags; f && (f = strstr(f, "--jobserver-")); f++) {
+        if(!strncmp(f, "--jobserver-auth=", 17)) auth = f + 17;
+        if(!strncmp(f, "--jobserver-fds=", 16)) auth = f + 16;
+    }
+    /* without -j make decides how many jobs there are, else the CPUs do */
+    if(bd->jobs < 1) bd->jobs = (auth && makejobs > 0) ? makejobs : cpu_count();
+    int r = -1, w = -1;
+    if(auth && !strncmp(auth, "fifo:", 5)) {
+        char *path = strprf(0, "%.*s", (int)strcspn(auth + 5, " "), auth + 5);
+        r = w = path ? open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC) : -1;
+        if(r == -1) BD_VERBOSE(bd, "jobserver fifo '%s' can't be opened: %s", path ? path : "", strerror(errno));
+        free(path);
+    } else if(auth && sscanf(auth, "%d,%d", &r, &w) == 2 && r >= 0 && w >= 0) {
+        /* make closes them for commands that aren't marked as recursive */
+        if(fcntl(r, F_GETFD) == -1 || fcntl(w, F_GETFD) == -1) {
+            BD_VERBOSE(bd, "jobserver %d,%d isn't open, prefix the command with + in the makefile", r, w);
+            r = w = -1;
+        }
+    } else if(bd->jobs > 1) {
+        /* nobody hands out tokens yet, so bd does: one for every job beyond the first */
+        int fds[2];
+        if(pipe(fds)) BD_ERR(bd,, "Failed to create the jobserver: %s", strerror(errno));
+        for(int i = 1; i < bd->jobs; i++) {
+            if(write(fds[1], "+", 1) != 1) BD_ERR(bd,, "Failed to fill the jobserver: %s", strerror(errno));
+        }
+        char *env = strprf(0, "%s%s-j%d --jobserver-auth=%d,%d", flags ? flags : "", flags && *flags ? " " : "", bd->jobs, fds[0], fds[1]);
+        if(!env || setenv("MAKEFLAGS", env, 1)) BD_ERR(bd,, "Failed to set MAKEFLAGS");
+        free(env);
+        r = fds[0];
+        w = fds[1];
+        BD_VERBOSE(bd, "jobserver with %d tokens at %d,%d", bd->jobs - 1, r, w);
+    }
+    if(r != -1 && r != w) {
+        /* an own open file description can be non-blocking without bothering the others reading the pipe */
+        char *path = strprf(0, "/proc/self/fd/%d", r);
+        int fd = path ? open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC) : -1;
+        free(path);
+        if(fd != -1) r = fd;
+        else fcntl(r, F_SETFL, fcntl(r, F_GETFL) | O_NONBLOCK);
+    }
+    bd->jobserver = (r != -1);
+    bd->jsread = r;
+    bd->jswrite = w;
+#endif
+}
+
+/* try to take a token, otherwise wait a little for one or for a job of ours to finish ; true if a token was taken */
+static bool jobserver_take(Bd *bd)
+{
+#if defined(OS_WIN)
+    (void)bd;
+    return false;
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    char c = 0;
+    if(read(bd->jsread, &c, 1) == 1) {
+        if(!str_app(&bd->tokens, "%c", c)) BD_ERR(bd, false, "Failed to keep jobserver token");
+        return true;
+    }
+    if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        BD_VERBOSE(bd, "jobserver failed, continuing without it: %s", strerror(errno));
+        bd->jobserver = false;
+        return false;
+    }
+    /* the finished job's slot is as good as a token */
+    struct pollfd pfd = {.fd = bd->jsread, .events = POLLIN};
+    poll(&pfd, 1, 10);
+    int status = 0;
+    struct rusage usage = {0};
+    pid_t pid = wait4(-1, &status, WNOHANG, &usage);
+    if(pid > 0) job_reap(bd, pid, status, &usage);
+    return false;
+#endif
+}
+
+/* give back the tokens no running job needs anymore */
+static void jobserver_give(Bd *bd)
+{
+#if defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    while(bd->tokens.len && bd->tokens.len >= (size_t)bd->running) {
+        char c = bd->tokens.s[--bd->tokens.len];
+        while(write(bd->jswrite, &c, 1) == -1 && errno == EINTR) {}
+    }
+#endif
+}
+
+/* wait until a job can be started ; false if no new jobs should be started because of an error */
+static bool job_slot(Bd *bd)
+{
+#if defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    jobserver_init(bd);
+    while(!bd->error && bd->running >= bd->jobs) job_wait(bd);
+    /* the first job runs on the token make gave bd itself */
+    while(!bd->error && bd->jobserver && (size_t)bd->running > bd->tokens.len) jobserver_take(bd);
+#endif
+    return !bd->error;
+}
+
+/* split a command the way the shell would, as long as it doesn't need anything but splitting at spaces.
+ * returns 0 if it does ; the argument array and the strings it points to are one allocation */
+static char **cmd_argv(char *cmd)
+{
+    size_t len = strlen(cmd);
+    int n = 0;
+    for(size_t i = 0; i < len; i++) {
+        if(strchr("|&;<>()$`\\\"'*?[]#~{}\n", cmd[i])) return 0;
+        if(cmd[i] != ' ' && cmd[i] != '\t' && (!i || cmd[i - 1] == ' ' || cmd[i - 1] == '\t')) n++;
+    }
+    /* a leading VAR=value is an assignment */
+    size_t first = strspn(cmd, " \t");
+    if(!n || memchr(&cmd[first], '=', strcspn(&cmd[first], " \t"))) return 0;
+    char **argv = malloc(sizeof(*argv) * (n + 1) + len + 1);
+    if(!argv) return 0;
+    char *str = (char *)&argv[n + 1];
+    memcpy(str, cmd, len + 1);
+    int k = 0;
+    for(char *tok = strtok(str, " \t"); tok; tok = strtok(0, " \t")) argv[k++] = tok;
+    argv[k] = 0;
+    return argv;
+}
+
+/* start a command without waiting for it, through the shell only if it has to.
+ * returns the pid, -1 if it couldn't be started */
+static int cmd_spawn(Bd *bd, char *cmd, int out)
+{
+#if defined(OS_WIN)
+    (void)bd;
+    (void)cmd;
+    (void)out;
+    return -1;
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    pid_t pid = -1;
+    char **argv = cmd_argv(cmd);
+    char *shell[] = {"sh", "-c", cmd, 0};
+    /* stdout and stderr both go into out */
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if(out != -1) {
+        posix_spawn_file_actions_adddup2(&actions, out, 1);
+        posix_spawn_file_actions_adddup2(&actions, out, 2);
+    }
+    int err = argv ? posix_spawnp(&pid, argv[0], &actions, 0, argv, environ) : posix_spawn(&pid, "/bin/sh", &actions, 0, shell, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if(err && !bd->noerr) printf("\033[91;1m[ERROR]\033[0m could not run '%s': %s\n", argv ? argv[0] : "/bin/sh", strerror(err));
+    if(err) pid = -1;
+    BD_VERBOSE(bd, "spawned %s%s", argv ? argv[0] : "a shell for ", argv ? "" : cmd);
+    free(argv);
+    return pid;
+#endif
+}
+
+/* run a command as soon as there is a free slot ; the job's strings are owned by the pool from now on */
+static void job_start(Bd *bd, char *cmd, Job *job)
+{
+    job->out = -1;
+    if(!job_slot(bd)) {
+        job_done(bd, job, -1);
+        return;
+    }
+#if defined(OS_WIN)
+    /* one at a time, -j only applies to the others */
+    job->lane = 1;
+    job->start = timer_now();
+    bd->count++;
+    if(job->msg) printf("%s\n", job->msg);
+    free(job->msg);
+    job->msg = 0;
+    job_done(bd, job, system(cmd));
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    if(!bd->job) {
+        bd->job = malloc(sizeof(*bd->job) * bd->jobs);
+        if(!bd->job) BD_ERR(bd,, "Failed to allocate job slots");
+    }
+    /* the lowest lane no running job is in */
+    job->lane = 1;
+    for(int i = 0; i < bd->running; i++) {
+        if(bd->job[i].lane != job->lane) continue;
+        job->lane++;
+        i = -1;
+    }
+    job->start = timer_now();
+    fflush(stdout);
+    job->out = job_capture(bd);
+    /* compilers don't color what goes to a file, so ask for it if bd's output is colored in the end ;
+     * after the signature was taken, so it doesn't make anything stale */
+    char *colored = (job->out != -1 && !job->link && isatty(STDOUT_FILENO) && cc_gnu(cmd)) ? strprf(0, "%s -fdiagnostics-color=always", cmd) : 0;
+    if(colored) cmd = colored;
+    pid_t pid = job->remote ? remote_spawn(bd, cmd, job) : cmd_spawn(bd, cmd, job->out);
+    free(colored);
+    if(pid == -1) {
+        /* same as the shell not finding the command */
+        job_done(bd, job, 127);
+        return;
+    }
+    job->pid = pid;
+    bd->job[bd->running++] = *job;
+    bd->count++;
+    BD_VERBOSE(bd, "started job %d (%d/%d running)", (int)pid, bd->running, bd->jobs);
+#endif
+}
+
+/* a code of -1 means it never ran */
+static void job_done(Bd *bd, Job *job, int code)
+{
+    Build *b = bd->builds ? &bd->builds[job->prj] : 0;
+    job_output(bd, job, code);
+    if(code != -1) {
+        const char *cat = !job->link ? "compile" : bd->prj[job->prj].type == BUILD_STATIC ? "archive" : "link";
+        trace(bd, cat, job->link ? job->objf : job->srcf, job->start, job->lane, job->cpu, job->rss);
+    }
+    if(!code) {
+        /* the next build starts the slow ones first */
+        double took = timer_now() - job->start;
+        if(job->log) deplog_time(bd, job->log, job->objf, took);
+        if(b && job->link && took > b->linktime) b->linktime = took;
+        if(b && !job->link && took > b->compiled) b->compiled = took;
+    }
+    if(job->link) {
+        statcache_forget(bd, job->objf);
+        if(!code && job->log) {
+            /* remember the libraries for the next relink decision */
+            StrArr *libs = libpaths(bd, bd->prj[job->prj].llibs);
+            if(libs) deplog_record(bd, job->log, job->objf, libs->s, libs->n, bd->hash);
+            strarr_free_p(libs);
+        }
+        if(!code && job->log) deplog_sign(bd, job->log, job->objf, job->sig);
+    } else {
+        statcache_forget(bd, job->objf);
+        if(!code && b && job->target >= 0) build_changed(bd, b, job);
+        if(!code && job->log) deplog_ingest(bd, job->log, job->objf, job->srcf, job->depf, bd->hash);
+        if(!code && job->log) deplog_sign(bd, job->log, job->objf, job->sig);
+        if(!code && job->log && job->cachekey) cache_store(bd, job->cachekey, job->log, job->objf, job->depf);
+    }
+    if(code > 0 && !bd->error) bd->error = code;
+    if(b && !job->link) b->compiling--;
+    if(b && job->link && !--b->linking) build_linked(bd, job->prj);
+}
+
+/* the target only has to be linked again if the object came out different */
+static void build_changed(Bd *bd, Build *b, Job *job)
+{
+    if(job->prevhash && filehash(bd, job->objf) == job->prevhash) {
+        BD_VERBOSE(bd, "'%s' didn't change", job->objf);
+        return;
+    }
+    b->newlinks[job->target] = true;
+}
+
+/* wait for any one running job to finish and collect its exit code */
+static void job_wait(Bd *bd)
+{
+#if defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    if(!bd->running) return;
+    int status = 0;
+    struct rusage usage = {0};
+    pid_t pid = wait4(-1, &status, 0, &usage);
+    if(pid == -1) {
+        if(errno == EINTR) return;
+        bd->running = 0;
+        BD_ERR(bd,, "Failed waiting for jobs: %s", strerror(errno));
+    }
+    job_reap(bd, pid, status, &usage);
+#endif
+}
+
+/* a job exited with status, usage points to its struct rusage */
+static void job_reap(Bd *bd, int pid, int status, void *usage)
+{
+#if defined(OS_WIN)
+    (void)bd;
+    (void)pid;
+    (void)status;
+    (void)usage;
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    int i = 0;
+    while(i < bd->running && bd->job[i].pid != pid) i++;
+    if(i == bd->running) return;
+    Job job = bd->job[i];
+    bd->job[i] = bd->job[--bd->running];
+    jobserver_give(bd);
+    struct rusage *ru = usage;
+    job.cpu = (double)(ru->ru_utime.tv_sec + ru->ru_stime.tv_sec) + (double)(ru->ru_utime.tv_usec + ru->ru_stime.tv_usec) * 1e-6;
+#if defined(OS_APPLE)
+    job.rss = (size_t)ru->ru_maxrss / 1024;
+#else
+    job.rss = (size_t)ru->ru_maxrss;
+#endif
+    int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    BD_VERBOSE(bd, "job %d finished with code %d", (int)pid, code);
+    job_done(bd, &job, code);
+#endif
+}
+
+static void job_wait_all(Bd *bd)
+{
+    while(bd->running) job_wait(bd);
+    jobserver_give(bd);
+}
+
+/* a file to capture the output of a job in, so it doesn't mix with the others ; -1 if there is none */
+static int job_capture(Bd *bd)
+{
+#if defined(OS_WIN)
+    (void)bd;
+    return -1;
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    char *tmp = getenv("TMPDIR");
+    char *path = strprf(0, "%s/bd-out-XXXXXX", tmp && *tmp ? tmp : "/tmp");
+    int fd = path ? mkstemp(path) : -1;
+    if(fd != -1) {
+        unlink(path);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    } else {
+        BD_VERBOSE(bd, "can't capture output in '%s': %s", path ? path : "", strerror(errno));
+    }
+    free(path);
+    return fd;
+#endif
+}
+
+static bool line_has(const char *line, size_t len, const char *s)
+{
+    size_t n = strlen(s);
+    for(size_t i = 0; i + n <= len; i++) {
+        if(!memcmp(&line[i], s, n)) return true;
+    }
+    return false;
+}
+
+/* false if the hash was added before */
+static bool seen_add(Bd *bd, uint64_t hash)
+{
+    if(!hash) hash = 1;
+    if(2 * (bd->nseen + 1) > bd->capseen) {
+        size_t cap = bd->capseen ? 2 * bd->capseen : 256;
+        uint64_t *seen = calloc(cap, sizeof(*seen));
+        if(!seen) return true;
+        for(size_t i = 0; i < bd->capseen; i++) {
+            if(!bd->seen[i]) continue;
+            size_t j = bd->seen[i] & (cap - 1);
+            while(seen[j]) j = (j + 1) & (cap - 1);
+            seen[j] = bd->seen[i];
+        }
+        free(bd->seen);
+        bd->seen = seen;
+        bd->capseen = cap;
+    }
+    size_t j = hash & (bd->capseen - 1);
+    for(; bd->seen[j]; j = (j + 1) & (bd->capseen - 1)) {
+        if(bd->seen[j] == hash) return false;
+    }
+    bd->seen[j] = hash;
+    bd->nseen++;
+    return true;
+}
+
+/* append the output of a compiler to text, leaving out the warnings shown before (e.g. from a header
+ * many sources include). a warning goes from what leads up to it ("In file included from", "In function")
+ * over its own line to the source lines and notes after it. lines are compared without their colors */
+static void output_filter(Bd *bd, Str *text, char *buf, size_t len)
+{
+    size_t block = 0;
+    bool body = false;  /* past the line of the diagnostic itself */
+    bool drop = false;
+    char *line = malloc(len + 1);
+    if(!line) {
+        str_app(text, "%.*s", (int)len, buf);
+        return;
+    }
+    for(size_t pos = 0; pos < len; ) {
+        size_t end = pos;
+        while(end < len && buf[end] != '\n') end++;
+        size_t n = 0;
+        for(size_t i = pos; i < end; i++) {
+            if(buf[i] == '\033' && i + 1 < end && buf[i + 1] == '[') {
+                for(i += 2; i < end && (buf[i] < 0x40 || buf[i] > 0x7e); i++);
+                continue;
+            }
+            line[n++] = buf[i];
+        }
+        bool cont = n && (line[0] == ' ' || line_has(line, n, ": note: "));
+        if(body && !cont) {
+            if(!drop) str_app(text, "%.*s", (int)(pos - block), &buf[block]);
+            block = pos;
+            body = false;
+        }
+        if(!body && (line_has(line, n, ": warning: ") || line_has(line, n, ": error: ") || line_has(line, n, ": fatal error: "))) {
+            body = true;
+            drop = line_has(line, n, ": warning: ") && !seen_add(bd, hash_data(line, n));
+            bd->repeated += drop;
+        }
+        pos = end < len ? end + 1 : end;
+    }
+    if(!body || !drop) str_app(text, "%.*s", (int)(len - block), &buf[block]);
+    free(line);
+}
+
+/* print the banner of a job at once with what it wrote ; with --ordered it waits until the build is done */
+static void job_output(Bd *bd, Job *job, int code)
+{
+    Str text = {0};
+    if(job->msg && code != -1) str_app(&text, "%s\n", job->msg);
+    free(job->msg);
+    job->msg = 0;
+#if defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    if(job->out != -1) {
+        struct stat attr = {0};
+        char *buf = (!fstat(job->out, &attr) && attr.st_size > 0) ? malloc(attr.st_size) : 0;
+        if(buf && pread(job->out, buf, attr.st_size, 0) == attr.st_size) output_filter(bd, &text, buf, attr.st_size);
+        free(buf);
+        close(job->out);
+        job->out = -1;
+    }
+#endif
+    if(!text.len) return;
+    if(bd->ordered && bd->builds) {
+        if(bd->nheld == bd->capheld) {
+            size_t cap = bd->capheld ? 2 * bd->capheld : 64;
+            Held *held = realloc(bd->held, sizeof(*held) * cap);
+            if(held) {
+                bd->held = held;
+                bd->capheld = cap;
+            }
+        }
+        if(bd->nheld < bd->capheld) {
+            bd->held[bd->nheld++] = (Held){.objf = job->objf, .text = text.s, .prj = job->prj, .link = job->link};
+            return;
+        }
+    }
+    fwrite(text.s, 1, text.len, stdout);
+    fflush(stdout);
+    str_free(&text);
+}
+
+/* the projects in order, each one's compiles by file and then its links */
+static int held_cmp(const void *a, const void *b)
+{
+    const Held *x = a, *y = b;
+    if(x->prj != y->prj) return x->prj - y->prj;
+    if(x->link != y->link) return x->link - y->link;
+    return strcmp(x->objf, y->objf);
+}
+
+static void held_flush(Bd *bd)
+{
+    if(bd->nheld) qsort(bd->held, bd->nheld, sizeof(*bd->held), held_cmp);
+    for(size_t i = 0; i < bd->nheld; i++) {
+        fputs(bd->held[i].text, stdout);
+        free(bd->held[i].text);
+    }
+    fflush(stdout);
+    free(bd->held);
+    bd->held = 0;
+    bd->nheld = 0;
+    bd->capheld = 0;
+}
+
+/* compiling remotely ; every message is a header line followed by the data it announces:
+ *  request "BD1 <command length> <input length> <i|ii>\n" command, preprocessed input
+ *  reply   "BD1 <exit code> <output length> <object length>\n" compiler output, object file
+ * in the command "@in" and "@out" stand for the input and the object file.
+ * an address is "host:port", or a path for a unix socket. returns the socket, -1 on failure */
+static int remote_connect(Bd *bd, const char *addr, bool listening)
+{
+#if defined(OS_WIN)
+    BD_ERR(bd, -1, "Remote compiling is not supported on "OS_STR);
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    int fd = -1;
+    if(strchr(addr, '/')) {
+        struct sockaddr_un sun = {.sun_family = AF_UNIX};
+        if(strlen(addr) >= sizeof(sun.sun_path)) BD_ERR(bd, -1, "Socket path '%s' is too long", addr);
+        strcpy(sun.sun_path, addr);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd != -1 && listening) unlink(addr);
+        if(fd != -1 && (listening ? bind(fd, (struct sockaddr *)&sun, sizeof(sun)) : connect(fd, (struct sockaddr *)&sun, sizeof(sun)))) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        const char *colon = strrchr(addr, ':');
+        char *host = strprf(0, "%.*s", colon ? (int)(colon - addr) : (int)strlen(addr), addr);
+        struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+        struct addrinfo *res = 0;
+        bool elsewhere = false;
+        if(host && !getaddrinfo(*host ? host : "localhost", colon ? colon + 1 : "7700", &hints, &res)) {
+            for(struct addrinfo *ai = res; ai && fd == -1; ai = ai->ai_next) {
+                /* nobody gets asked who they are, so workers don't listen to other machines */
+                bool loopback = (ai->ai_family == AF_INET && (ntohl(((struct sockaddr_in *)ai->ai_addr)->sin_addr.s_addr) >> 24) == 127)
+                    || (ai->ai_family == AF_INET6 && IN6_IS_ADDR_LOOPBACK(&((struct sockaddr_in6 *)ai->ai_addr)->sin6_addr));
+                if(listening && !loopback) {
+                    elsewhere = true;
+                    continue;
+                }
+                fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+                int on = 1;
+                if(fd != -1 && listening) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+                if(fd != -1 && (listening ? bind(fd, ai->ai_addr, ai->ai_addrlen) : connect(fd, ai->ai_addr, ai->ai_addrlen))) {
+                    close(fd);
+                    fd = -1;
+                }
+            }
+            freeaddrinfo(res);
+        }
+        free(host);
+        if(fd == -1 && elsewhere) BD_ERR(bd, -1, "Workers only listen on localhost or a unix socket, not on '%s' ; reach them from elsewhere through e.g. ssh -L", addr);
+    }
+    if(fd != -1 && listening && listen(fd, 64)) {
+        close(fd);
+        fd = -1;
+    }
+    if(fd == -1) BD_VERBOSE(bd, "could not %s '%s': %s", listening ? "listen on" : "connect to", addr, strerror(errno));
+    return fd;
+#endif
+}
+
+/* send or receive exactly len bytes */
+static bool remote_io(int fd, char *buf, size_t len, bool send)
+{
+#if defined(OS_WIN)
+    (void)fd;
+    (void)buf;
+    return !len && send;
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    while(len) {
+        ssize_t n = send ? write(fd, buf, len) : read(fd, buf, len);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        buf += n;
+        len -= n;
+    }
+    return true;
+#endif
+}
+
+/* the header line of a message, without its line break */
+static char *remote_header(int fd)
+{
+    static char line[128];
+    size_t len = 0;
+    while(len + 1 < sizeof(line) && remote_io(fd, &line[len], 1, false)) {
+        if(line[len] == '\n') {
+            line[len] = 0;
+            return line;
+        }
+        len++;
+    }
+    return 0;
+}
+
+/* compile in a child of bd, so it's a job like any other ; returns its pid, -1 if it couldn't be started */
+static int remote_spawn(Bd *bd, char *cmd, Job *job)
+{
+#if defined(OS_WIN)
+    (void)cmd;
+    (void)job;
+    BD_ERR(bd, -1, "Remote compiling is not supported on "OS_STR);
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    pid_t pid = fork();
+    if(!pid) {
+        if(job->out != -1) {
+            dup2(job->out, 1);
+            dup2(job->out, 2);
+        }
+        int code = remote_compile(bd, cmd, job);
+        fflush(stdout);
+        _exit(code);
+    }
+    if(pid == -1) BD_ERR(bd, -1, "Failed to start job: %s", strerror(errno));
+    return pid;
+#endif
+}
+
+/* preprocess here, compile on a worker and write what it sends back ; compiles here if no worker can be reached.
+ * returns the exit code of the compiler */
+static int remote_compile(Bd *bd, char *cmd, Job *job)
+{
+#if defined(OS_WIN)
+    (void)cmd;
+    (void)job;
+    BD_ERR(bd, 127, "Remote compiling is not supported on "OS_STR);
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    char **argv = cmd_argv(cmd);
+    if(!argv) return 127;
+    int n = 0;
+    while(argv[n]) n++;
+    /* -c becomes -E, the output a temporary file and the dependency file gets written on the way */
+    char *ext = src_is_cxx(job->srcf) ? "ii" : "i";
+    char *tmpf = strprf(0, "%s.%s", job->objf, ext);
+    char **pre = malloc(sizeof(*pre) * (n + 5));
+    Str remote = {0};
+    if(!tmpf || !pre) return 127;
+    for(int i = 0; i < n; i++) {
+        bool out = i && !strcmp(argv[i - 1], "-o");
+        pre[i] = !strcmp(argv[i], "-c") ? "-E" : out ? tmpf : argv[i];
+        /* the worker doesn't see any headers, so it gets no preprocessor options */
+        bool skip = false;
+        if(i && !out && strcmp(argv[i], "-o") && strcmp(argv[i], job->srcf) && remote_arg(argv[i], &skip) != REMOTE_SEND) {
+            if(skip && i + 1 < n) pre[i + 1] = argv[i + 1], i++;
+            continue;
+        }
+        str_app(&remote, "%s%s", remote.len ? " " : "", out ? "@out" : !strcmp(argv[i], job->srcf) ? "@in" : argv[i]);
+    }
+    char *tail[] = {"-MF", job->depf, "-MT", job->objf, 0};
+    memcpy(&pre[n], tail, sizeof(tail));
+    pid_t pid = -1;
+    int status = 0;
+    if(posix_spawnp(&pid, pre[0], 0, 0, pre, environ) || waitpid(pid, &status, 0) == -1) status = 127 << 8;
+    int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    size_t srclen = 0;
+    char *src = code ? 0 : read_file(bd, tmpf, &srclen);
+    remove(tmpf);
+    if(!src) {
+        free(tmpf), free(pre), free(argv), str_free(&remote);
+        return code ? code : 1;
+    }
+    /* spread the jobs over the workers by the row they're in */
+    StrArr addrs = {0};
+    for(char *a = bd->remote; a && *a; a += strcspn(a, ",") + (a[strcspn(a, ",")] ? 1 : 0)) {
+        strarr_push(bd, &addrs, path_intern(bd, a, strcspn(a, ",")));
+    }
+    int fd = -1;
+    for(int i = 0; i < addrs.n && fd == -1; i++) fd = remote_connect(bd, addrs.s[(job->lane - 1 + i) % addrs.n], false);
+    char *head = strprf(0, "BD1 %zu %zu %s\n", remote.len, srclen, ext);
+    bool sent = fd != -1 && head && remote_io(fd, head, strlen(head), true) && remote_io(fd, remote.s, remote.len, true) && remote_io(fd, src, srclen, true);
+    char *reply = sent ? remote_header(fd) : 0;
+    size_t outlen = 0, objlen = 0;
+    bool ok = reply && sscanf(reply, "BD1 %d %zu %zu", &code, &outlen, &objlen) == 3;
+    char *data = ok ? malloc(outlen + objlen + 1) : 0;
+    ok = data && remote_io(fd, data, outlen + objlen, false);
+    if(ok) {
+        fwrite(data, 1, outlen, stdout);
+        FILE *fp = code ? 0 : fopen(job->objf, "wb");
+        if(fp && fwrite(&data[outlen], 1, objlen, fp) != objlen) code = 1;
+        if(fp && fclose(fp)) code = 1;
+        if(!code && !fp) code = 1;
+    } else {
+        /* nobody to compile it, do it here */
+        if(bd->verbose) printf("compiling '%s' here, no worker answered\n", job->srcf);
+        pid = -1;
+        status = 127 << 8;
+        if(posix_spawnp(&pid, argv[0], 0, 0, argv, environ) || waitpid(pid, &status, 0) == -1) status = 127 << 8;
+        code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+    if(fd != -1) close(fd);
+    free(data), free(head), free(src), free(tmpf), free(pre), free(argv);
+    str_free(&remote);
+    strarr_free(&addrs);
+    return code;
+#endif
+}
+
+/* whether the command runs gcc or clang, going by the name of the program */
+static bool cc_gnu(const char *cmd)
+{
+    size_t len = strcspn(cmd, " ");
+    for(size_t i = len; i > 0; i--) {
+        if(cmd[i - 1] != '/' && cmd[i - 1] != '\\') continue;
+        cmd += i;
+        len -= i;
+        break;
+    }
+    char *cc = strprf(0, "%.*s", (int)len, cmd);
+    bool gnu = cc && (strstr(cc, "gcc") || strstr(cc, "g++") || strstr(cc, "clang") || !strcmp(cc, "cc") || !strcmp(cc, "c++"));
+    free(cc);
+    return gnu;
+}
+
+/* workers only get options that name no files: the ones of the preprocessor were used up here already, anything
+ * else not known to be harmless is refused. *skip is set if the next argument belongs to a dropped option */
+static RemoteArg remote_arg(const char *arg, bool *skip)
+{
+    *skip = !strcmp(arg, "-I") || !strcmp(arg, "-D") || !strcmp(arg, "-U") || !strcmp(arg, "-MF") || !strcmp(arg, "-MT") || !strcmp(arg, "-MQ");
+    static const char *separate[] = {"-include", "-imacros", "-isystem", "-iquote", "-idirafter", "-iprefix", "-iwithprefix", "-iwithprefixbefore", "-isysroot", "-imultilib"};
+    for(size_t k = 0; k < SIZE_ARRAY(separate); k++) {
+        if(!strcmp(arg, separate[k])) *skip = true;
+    }
+    if(*skip || !strncmp(arg, "-I", 2) || !strncmp(arg, "-D", 2) || !strncmp(arg, "-U", 2) || !strncmp(arg, "-M", 2) || !strncmp(arg, "-i", 2)) return REMOTE_DROP;
+    /* no paths, not even ".." on its own */
+    if(strchr(arg, '/') || strchr(arg, '\\') || strstr(arg, "..")) return REMOTE_REFUSE;
+    if(!strcmp(arg, "-c") || !strcmp(arg, "-w") || !strcmp(arg, "-ansi") || !strcmp(arg, "-pthread") || !strcmp(arg, "-pedantic") || !strcmp(arg, "-pedantic-errors")) return REMOTE_SEND;
+    if(!strncmp(arg, "-O", 2) || !strncmp(arg, "-g", 2) || !strncmp(arg, "-m", 2) || !strncmp(arg, "-std=", 5)) return REMOTE_SEND;
+    /* -Wp, -Wa, and -Wl, hand anything to the tools below */
+    if(!strncmp(arg, "-W", 2)) return (arg[2] && arg[3] == ',') ? REMOTE_REFUSE : REMOTE_SEND;
+    /* plugins are looked up by name */
+    if(!strncmp(arg, "-f", 2)) return strncmp(arg, "-fplugin", 8) ? REMOTE_SEND : REMOTE_REFUSE;
+    return REMOTE_REFUSE;
+}
+
+/* whether a compile command can go to a worker as remote_compile() sends it */
+static bool remote_able(char **argv, const char *srcf)
+{
+    for(int i = 1; argv[i]; i++) {
+        bool skip = false;
+        if(!strcmp(argv[i], srcf)) continue;
+        if(!strcmp(argv[i], "-o") && argv[i + 1]) i++;
+        else if(remote_arg(argv[i], &skip) == REMOTE_REFUSE) return false;
+        else if(skip && argv[i + 1]) i++;
+    }
+    return true;
+}
+
+/* workers only run compilers, with nothing that makes them load, read or write other files ; they run in the
+ * temporary folder of the request, so a relative name can't reach any further */
+static bool worker_allowed(char **argv)
+{
+    if(strchr(argv[0], '/') || strchr(argv[0], '\\') || !cc_gnu(argv[0])) return false;
+    int in = 0, out = 0;
+    for(int i = 1; argv[i]; i++) {
+        bool skip = false;
+        if(!strcmp(argv[i], "@in")) in++;
+        else if(!strcmp(argv[i], "-o") && argv[i + 1] && !strcmp(argv[i + 1], "@out")) out++, i++;
+        else if(remote_arg(argv[i], &skip) != REMOTE_SEND) return false;
+    }
+    return in == 1 && out == 1;
+}
+
+/* answer one request */
+static void worker_serve(Bd *bd, int fd)
+{
+#if defined(OS_WIN)
+    (void)bd;
+    (void)fd;
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    char *head = remote_header(fd);
+    size_t cmdlen = 0, srclen = 0;
+    char ext[3] = {0};
+    if(!head || sscanf(head, "BD1 %zu %zu %2s", &cmdlen, &srclen, ext) != 3 || (strcmp(ext, "i") && strcmp(ext, "ii"))) return;
+    if(cmdlen > (1 << 20) || srclen > ((size_t)1 << 32)) return;
+    char *cmd = malloc(cmdlen + 1), *src = malloc(srclen + 1);
+    char dir[] = "/tmp/bd-worker-XXXXXX";
+    if(!cmd || !src || !remote_io(fd, cmd, cmdlen, false) || !remote_io(fd, src, srclen, false) || !mkdtemp(dir)) {
+        free(cmd), free(src);
+        return;
+    }
+    cmd[cmdlen] = 0;
+    char *inf = strprf(0, "%s/in.%s", dir, ext), *outf = strprf(0, "%s/out.o", dir), *logf = strprf(0, "%s/log", dir);
+    FILE *fp = inf ? fopen(inf, "wb") : 0;
+    bool ok = fp && fwrite(src, 1, srclen, fp) == srclen;
+    if(fp && fclose(fp)) ok = false;
+    char **argv = ok ? cmd_argv(cmd) : 0;
+    int code = 127;
+    char *in = inf ? strrchr(inf, '/') + 1 : 0;
+    if(argv && worker_allowed(argv) && !chdir(dir)) {
+        for(int i = 0; argv[i]; i++) {
+            if(!strcmp(argv[i], "@in")) argv[i] = in;
+            if(!strcmp(argv[i], "@out")) argv[i] = "out.o";
+        }
+        BD_MSG(bd, "\033[94;1m[ worker ]\033[0m %s", cmd); /* bright blue color */
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, 1, logf, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        posix_spawn_file_actions_adddup2(&actions, 1, 2);
+        pid_t pid = -1;
+        int status = 0;
+        if(!posix_spawnp(&pid, argv[0], &actions, 0, argv, environ) && waitpid(pid, &status, 0) != -1) {
+            code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        }
+        posix_spawn_file_actions_destroy(&actions);
+    } else {
+        BD_MSG(bd, "\033[91;1m[ worker ]\033[0m refused %s", cmd); /* bright red color */
+        fp = logf ? fopen(logf, "wb") : 0;
+        if(fp) fprintf(fp, "the worker only runs gcc, g++ or clang with options that name no files, not: %s\n", cmd);
+        if(fp) fclose(fp);
+    }
+    size_t outlen = 0, objlen = 0;
+    char *out = read_file(bd, logf, &outlen);
+    char *obj = code ? 0 : read_file(bd, outf, &objlen);
+    if(!code && !obj) code = 1;
+    char *reply = strprf(0, "BD1 %d %zu %zu\n", code, out ? outlen : 0, obj ? objlen : 0);
+    if(reply && remote_io(fd, reply, strlen(reply), true) && remote_io(fd, out, out ? outlen : 0, true)) remote_io(fd, obj, obj ? objlen : 0, true);
+    /* the compiler may have left more than the object behind */
+    DIR *dp = opendir(dir);
+    for(struct dirent *de = dp ? readdir(dp) : 0; de; de = readdir(dp)) {
+        if(strcmp(de->d_name, ".") && strcmp(de->d_name, "..")) {
+            char *f = strprf(0, "%s/%s", dir, de->d_name);
+            if(f) remove(f);
+            free(f);
+        }
+    }
+    if(dp) closedir(dp);
+    rmdir(dir);
+    free(reply), free(out), free(obj), free(argv), free(inf), free(outf), free(logf), free(cmd), free(src);
+#endif
+}
+
+/* serve requests of bd --remote until killed, each one in its own process */
+static void worker(Bd *bd, const char *addr)
+{
+#if defined(OS_WIN)
+    (void)addr;
+    BD_ERR(bd,, "Workers are not supported on "OS_STR);
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    if(!addr) addr = "localhost:7700";
+    int fd = remote_connect(bd, addr, true);
+    if(fd == -1 && bd->error) return;
+    if(fd == -1) BD_ERR(bd,, "Could not listen on '%s': %s", addr, strerror(errno));
+    BD_MSG(bd, "\033[92;1m[ worker ]\033[0m listening on %s", addr); /* bright green color */
+    /* finished children don't have to be waited for */
+    signal(SIGCHLD, SIG_IGN);
+    for(;;) {
+        int conn = accept(fd, 0, 0);
+        if(conn == -1) {
+            if(errno == EINTR || errno == ECONNABORTED) continue;
+            BD_ERR(bd,, "Could not accept: %s", strerror(errno));
+        }
+        fflush(stdout);
+        pid_t pid = fork();
+        if(!pid) {
+            signal(SIGCHLD, SIG_DFL);
+            close(fd);
+            worker_serve(bd, conn);
+            close(conn);
+            fflush(stdout);
+            _exit(0);
+        }
+        close(conn);
+    }
+#endif
+}
+
+static StrArr *extract_dirs(Bd *bd, char *path, bool skiplast)
+{
+    StrArr *result = strarr_new();
+    /* go over the given path and split by '/' */
+    int len = path ? strlen(path) : 0;
+    for(int i = 0; i < len; i++) {
+        bool mkd = false;
+        if(path[i] == '/') mkd = true;
+        else if(i + 1 == len && !skiplast) mkd = true;
+        if(mkd && !strarr_push(bd, result, path_intern(bd, path, i + 1))) return 0;
+    }
+    return result;
+}
+
+/* compile for the k-th target ; the one past the last stands for all of them and -1 for none */
+static void compile(Bd *bd, Prj *p, int k, char *objf, char *srcf, char *depf)
+{
+    if(!job_slot(bd)) return;
+    Build *b = &bd->builds[p - bd->prj];
+    char *name = (k >= 0 && k < b->targets->n) ? b->targets->s[k] : p->name ? p->name : "a";
+    Job job = {
+        .objf = objf,
+        .srcf = srcf,
+        .depf = depf,
+        .log = deplog_get(bd, p->objd),
+        .prevhash = filehash(bd, objf),
+        .target = k,
+        .prj = p - bd->prj,
+    };
+    statcache_forget(bd, objf);
+    char *cc = static_cc_cxx(bd, p, objf, srcf);
+    double t = timer_now();
+    char *pchf = (p->pch && strcmp(srcf, p->pch)) ? path_prf(bd, "%s.gch", prj_pch(bd, p, prj_cxx(bd, p))) : 0;
+    uint64_t cachekey = bd->cache ? cache_direct(bd, cc, srcf, pchf) : 0;
+    if(cachekey && cache_restore(bd, cachekey, objf, depf)) {
+        trace(bd, "cache", srcf, t, 0, 0, 0);
+        bd->cachehits++;
+        statcache_forget(bd, depf);
+        BD_MSG(bd, "\033[96;1m[ %s ]\033[0m %s from cache", name, objf); /* bright cyan color */
+        if(k >= 0) build_changed(bd, b, &job);
+        deplog_ingest(bd, job.log, objf, srcf, depf, bd->hash);
+        deplog_sign(bd, job.log, objf, hash_data(cc, strlen(cc)));
+        free(cc);
+        return;
+    }
+    if(cachekey) bd->cachemisses++;
+    job.msg = bd->quiet ? 0 : strprf(0, "\033[94;1m[ %s ]\033[0m %s", name, cc); /* bright blue color */
+    job.cachekey = cachekey;
+    job.sig = hash_data(cc, strlen(cc));
+    /* the precompiled header can't be shipped, and the command gets taken apart */
+    char **argv = (bd->remote && !p->pch) ? cmd_argv(cc) : 0;
+    job.remote = argv && remote_able(argv, srcf);
+    if(argv && !job.remote) BD_VERBOSE(bd, "compiling '%s' here, its command names files a worker can't have", srcf);
+    free(argv);
+    b->compiling++;
+    job_start(bd, cc, &job);
+    free(cc);
+}
+
+static void verify_cc_cxx(Bd *bd, Prj *p, char *filename)
+{
+    char *cc_use = 0;
+    size_t filename_len = strlen(filename);
+    if(strrstr(filename, ".c") == filename_len - 2) {
+        cc_use = p->cc ? p->cc : static_cc_def;
+        if(!bd->use_cxx) bd->cc_cxx = cc_use;
+    }
+    if(strrstr(filename, ".cc") == filename_len - 3 || strrstr(filename, ".cpp") == filename_len - 4) {
+        cc_use = p->cxx ? p->cxx : static_cxx_def;
+        bd->cc_cxx = cc_use;
+        bd->use_cxx = true;
+    }
+    if(!cc_use) BD_ERR(bd,, "Unsupported file extension");
+}
+
+/* links bd->ofiles in the background */
+static void link_objs(Bd *bd, int i, char *name, bool avoidlink)
+{
+    Prj *p = &bd->prj[i];
     if(bd->error) return;
-    /* get most recent modified time of any included library */
-    uint64_t m_llibs = modlibs(bd, p->llibs);
+    char *ld = 0, *target = 0;
+    uint64_t sig = 0;
+    DepLog *log = deplog_get(bd, p->objd);
+    if(bd->ofiles.n) {
+        Str ofiles = {0};
+        for(int i = 0; i < bd->ofiles.n; i++) {
+            if(!str_app(&ofiles, "%s%s", bd->ofiles.s[i], i + 1 < bd->ofiles.n ? " " : "")) BD_ERR(bd,, "Failed to list object files");
+        }
+        ld = static_ld(bd, p, name, ofiles.s, p->llibs);
+        target = path_prf(bd, "%s%s", name, static_ext[p->type]);
+        str_free(&ofiles);
+        sig = ld ? hash_data(ld, strlen(ld)) : 0;
+        uint64_t m_target = target ? modtime(bd, target) : 0;
+        /* the link line changed, e.g. an option or the list of objects */
+        if(ld && target && log && avoidlink && m_target) avoidlink = deplog_signed(bd, log, target, sig);
+        /* an archive with the same members only needs the changed ones replaced ;
+         * otherwise it's made anew, as members that are gone would stay in it */
+        if(ld && target && log && !avoidlink && p->type == BUILD_STATIC && m_target) {
+            bool update = deplog_signed(bd, log, target, sig);
+            Str changed = {0};
+            for(int i = 0; update && i < bd->ofiles.n; i++) {
+                if(modtime(bd, bd->ofiles.s[i]) > m_target && !str_app(&changed, "%s%s", changed.len ? " " : "", bd->ofiles.s[i])) update = false;
+            }
+            if(update && changed.len) {
+                free(ld);
+                ld = static_ld(bd, p, name, changed.s, p->llibs);
+            } else {
+                remove(target);
+            }
+            str_free(&changed);
+        }
+    }
+    if(ld && target && !avoidlink) {
+        if(job_slot(bd)) {
+            Job job = {
+                .objf = target,
+                .log = log,
+                .sig = sig,
+                .prj = i,
+                .link = true,
+                .msg = bd->quiet ? 0 : strprf(0, "\033[93;1m[ %s ]\033[0m %s", name, ld), /* bright yellow color*/
+            };
+            bd->builds[i].linking++;
+            job_start(bd, ld, &job);
+        }
+    } else {
+        BD_MSG(bd, "\033[92;1m[ %s ]\033[0m is up to date", name); /* bright green color */
+    }
+    free(ld);
+    bd->cc_cxx = static_cc_def;
+    bd->use_cxx = false;
+    strarr_free(&bd->ofiles);
+}
+
+/* does `p` link against the output of `dep`? */
+static bool prj_links(Bd *bd, Prj *p, Prj *dep)
+{
+    if(p == dep) return false;
+    char *name = dep->name ? dep->name : "a";
+    for(int k = 0; k < p->deps.n; k++) {
+        if(!strcmp(p->deps.s[k], name)) return true;
+    }
+    if(dep->type != BUILD_STATIC && dep->type != BUILD_SHARED) return false;
+    char *target = path_prf(bd, "%s%s", name, static_ext[dep->type]);
+    StrArr *libs = libpaths(bd, p->llibs);
+    bool result = false;
+    for(int k = 0; libs && target && k < libs->n; k++) {
+        if(libs->s[k] == target) result = true;
+    }
+    strarr_free_p(libs);
+    return result;
+}
+
+/* start compiling everything that changed ; linking waits until all of it is done */
+static void build_compile(Bd *bd, int i)
+{
+    if(bd->error) return;
+    Prj *p = &bd->prj[i];
+    Build *b = &bd->builds[i];
     /* gather all files */
     StrArr *dirn = extract_dirs(bd, p->name, (bool)(p->type != BUILD_EXAMPLES));
     if(!dirn) BD_ERR(bd,, "Failed to get directories from name");
@@ -599,101 +3176,467 @@ static void build(Bd *bd, Prj *p)
     StrArr *srcfs = prj_srcfs(bd, p);
     if(!srcfs) BD_ERR(bd,, "No source files");
     BD_VERBOSE(bd, "extracted %d source files", srcfs->n);
-    StrArr *objfs = prj_srcfs_chg_dirext(bd, srcfs, p->objd, ".o");
-    if(!objfs) BD_ERR(bd,, "No object files");
-    BD_VERBOSE(bd, "converted %d source files to object files", srcfs->n);
-    StrArr *depfs = prj_srcfs_chg_dirext(bd, srcfs, p->objd, ".d");
-    if(!depfs) BD_ERR(bd,, "No dependency files");
-    BD_VERBOSE(bd, "converted %d source files to dependency files", srcfs->n);
-    StrArr *targets = prj_names(bd, p, srcfs);
-    if(!targets) BD_ERR(bd,, "No targets to build");
-    bool newlink = false;
+    b->targets = prj_names(bd, p, srcfs);
+    if(!b->targets) BD_ERR(bd,, "No targets to build");
     /* create folders */
     for(int i = 0; i < dirn->n; i++) makedir(dirn->s[i]);
     for(int i = 0; i < diro->n; i++) makedir(diro->s[i]);
-    /* now compile it */
-    for(int k = 0; k < targets->n && !bd->error; k++) {
-        /* maybe check if target even exists */
-        char *targetstr = strprf(0, "%s%s", targets->s[k], static_ext[p->type]);
-        uint64_t m_target = modtime(bd, targetstr);
-        BD_VERBOSE(bd, "modified time of target '%s' = %zu", targetstr, (size_t)m_target);
-        newlink &= (p->type != BUILD_EXAMPLES);
-        newlink |= (bool)(m_llibs > m_target) || (bool)(m_target == 0);
-        free(targetstr);
+    strarr_free_pa(dirn, diro);
+    if(p->unity > 0 && p->type != BUILD_EXAMPLES) {
+        b->units = prj_unity(bd, p, srcfs, true, 0);
+        if(!b->units) BD_ERR(bd,, "Failed to generate unity files");
+        BD_VERBOSE(bd, "compiling %d unity files and split out sources instead of %d sources", b->units->n, srcfs->n);
+        srcfs = b->units;
+    }
+    StrArr *supfs = p->type == BUILD_EXAMPLES ? prj_supfs(bd, p) : 0;
+    if(supfs && supfs->n) {
+        /* examples are followed by the support sources */
+        b->units = strarr_new();
+        for(int k = 0; b->units && k < srcfs->n + supfs->n; k++) strarr_push(bd, b->units, k < srcfs->n ? srcfs->s[k] : supfs->s[k - srcfs->n]);
+        if(!b->units || bd->error) BD_ERR(bd,, "Failed to list support files");
+        BD_VERBOSE(bd, "extracted %d support files", supfs->n);
+        srcfs = b->units;
+    }
+    b->objfs = prj_srcfs_chg_dirext(bd, srcfs, p->objd, ".o");
+    if(!b->objfs) BD_ERR(bd,, "No object files");
+    BD_VERBOSE(bd, "converted %d source files to object files", srcfs->n);
+    b->depfs = prj_srcfs_chg_dirext(bd, srcfs, p->objd, ".d");
+    if(!b->depfs) BD_ERR(bd,, "No dependency files");
+    BD_VERBOSE(bd, "converted %d source files to dependency files", srcfs->n);
+    b->newlinks = calloc(b->targets->n + 1, sizeof(*b->newlinks));
+    if(!b->newlinks) BD_ERR(bd,, "Failed to allocate link list");
+    StrArr *objfs = b->objfs, *depfs = b->depfs, *targets = b->targets;
+    DepLog *log = deplog_get(bd, p->objd);
+    if(!log) BD_ERR(bd,, "No dependency log");
+    bd->cc_cxx = static_cc_def;
+    bd->use_cxx = false;
+    /* the precompiled header is compiled while checking */
+    char *name = p->name ? p->name : "a";
+    double t = timer_now();
+    /* now compile it ; the support objects of examples come last and belong to all of them */
+    int ntargets = targets->n + (p->type == BUILD_EXAMPLES && srcfs->n > targets->n);
+    for(int k = 0; k < ntargets && !bd->error; k++) {
+        if(k < targets->n) {
+            /* maybe check if target even exists */
+            char *targetstr = path_prf(bd, "%s%s", targets->s[k], static_ext[p->type]);
+            if(!targetstr) break;
+            uint64_t m_target = modtime(bd, targetstr);
+            BD_VERBOSE(bd, "modified time of target '%s' = %zu", targetstr, (size_t)m_target);
+            b->newlinks[k] = (bool)(m_target == 0);
+        }
         /* set up loop */
         int i0 = (p->type == BUILD_EXAMPLES) ? k : 0;
-        int iE = (p->type == BUILD_EXAMPLES) ? k + 1 : srcfs->n;
+        int iE = (p->type == BUILD_EXAMPLES && k < targets->n) ? k + 1 : srcfs->n;
         for(int i = i0; i < iE && !bd->error; i++) {
-            /* determine if it's c or cpp */
+            /* every translation unit gets the compiler and precompiled header of its own language,
+             * only linking goes by all of them */
+            bd->use_cxx = false;
             verify_cc_cxx(bd, p, srcfs->s[i]);
             /* go over source file(s) */
             uint64_t m_srcf = modtime(bd, srcfs->s[i]);
             BD_VERBOSE(bd, "modified time of source '%s' = %zu", srcfs->s[i], (size_t)m_srcf);
             uint64_t m_objf = modtime(bd, objfs->s[i]);
             BD_VERBOSE(bd, "modified time of object '%s' = %zu", objfs->s[i], (size_t)m_objf);
-            if(m_objf >= m_srcf) {
-                /* check dependencies */
-                bool recompiled = false;
-                StrArr *hdrfs = parse_dfile(bd, depfs->s[i]);
-                for(int j = 0; hdrfs && j < hdrfs->n && !bd->error; j++) {
-                    uint64_t m_hdrf = modtime(bd, hdrfs->s[j]);
-                    BD_VERBOSE(bd, "modified time of header '%s' = %zu", hdrfs->s[j], (size_t)m_hdrf);
-                    if(m_hdrf > m_objf) {
-                        /* header file was updated, recompile */
-                        compile(bd, p, targets->s[k], objfs->s[i], srcfs->s[i]);
-                        newlink |= true;
-                        recompiled = true;
-                        break;
-                    } 
-                }
-                if(!recompiled && (newlink || p->type != BUILD_EXAMPLES)) {
-                    /* compilation up to date, but it should re-link */
-                    BD_VERBOSE(bd, "add file to link list '%s'", objfs->s[i]);
-                    if(!strarr_set_n(&bd->ofiles, bd->ofiles.n + 1)) BD_ERR(bd,, "Failed to modify StrArr");
-                    bd->ofiles.s[bd->ofiles.n - 1] = strprf(0, "%s", objfs->s[i]);
-                }
-                strarr_free_p(hdrfs);
-            } else {
-                compile(bd, p, targets->s[k], objfs->s[i], srcfs->s[i]);
-                newlink |= true;
+            /* check source, dependencies and the precompiled header */
+            uint64_t m_pch = p->pch ? pch_build(bd, (int)(p - bd->prj)) : 0;
+            char *cc = static_cc_cxx(bd, p, objfs->s[i], srcfs->s[i]);
+            if(!cc) BD_ERR(bd,, "Failed to create compile command");
+            int changed = obj_changed(bd, log, objfs->s[i], srcfs->s[i], depfs->s[i], m_objf, hash_data(cc, strlen(cc))) || m_pch > m_objf;
+            free(cc);
+            if(!changed) continue;
+            if(bd->nstale == bd->capstale) {
+                int cap = bd->capstale ? 2 * bd->capstale : 64;
+                Stale *stale = realloc(bd->stale, sizeof(*stale) * cap);
+                if(!stale) BD_ERR(bd,, "Failed to queue '%s'", srcfs->s[i]);
+                bd->stale = stale;
+                bd->capstale = cap;
+            }
+            bd->stale[bd->nstale] = (Stale){.objf = objfs->s[i], .srcf = srcfs->s[i], .depf = depfs->s[i], .cc_cxx = bd->cc_cxx, .prj = (int)(p - bd->prj), .k = k, .index = bd->nstale};
+            bd->nstale++;
+            b->pending++;
+        }
+    }
+    trace(bd, "check", name, t, 0, 0, 0);
+    b->queued = true;
+}
+
+/* check the object against its source, logged dependencies and the command `sig` is the hash of */
+static int obj_changed(Bd *bd, DepLog *log, char *objf, char *srcf, char *depf, uint64_t m_objf, uint64_t sig)
+{
+    if(m_objf && !deplog_signed(bd, log, objf, sig)) return 1;
+    int changed = m_objf ? deplog_check(bd, log, objf, m_objf, bd->hash) : 1;
+    if(changed < 0) {
+        /* not logged yet, take what the compiler wrote last time */
+        changed = (modtime(bd, srcf) > m_objf);
+        if(!changed) {
+            /* hashed already, so a header that only gets touched later doesn't recompile it ; the check goes by
+             * time, as a header newer than the object isn't what it was compiled with */
+            deplog_ingest(bd, log, objf, srcf, depf, bd->hash);
+            changed = deplog_check(bd, log, objf, m_objf, false);
+        }
+    }
+    return changed;
+}
+
+/* the compiler in bd->cc_cxx is the C++ one */
+static bool prj_cxx(Bd *bd, Prj *p)
+{
+    return !strcmp(bd->cc_cxx, p->cxx ? p->cxx : static_cxx_def);
+}
+
+/* what the sources include to get the precompiled header ; the compiler looks for it with .gch appended.
+ * a C and a C++ one are kept, as either can't be used for the other language */
+static char *prj_pch(Bd *bd, Prj *p, bool cxx)
+{
+    int slash = strrstr(p->pch, "/");
+    char *base = &p->pch[slash + 1];
+    int ext = strrstr(base, ".");
+    return path_prf(bd, "%s%s%.*s-%s.h", p->objd ? p->objd : "", p->objd ? SLASH_STR : "", ext > 0 ? ext : (int)strlen(base), base, cxx ? "cxx" : "c");
+}
+
+/* compile the precompiled header for the language in bd->cc_cxx if needed and wait for it,
+ * as every source of the project depends on it. returns its modified time */
+static uint64_t pch_build(Bd *bd, int i)
+{
+    Prj *p = &bd->prj[i];
+    Build *b = &bd->builds[i];
+    bool cxx = prj_cxx(bd, p);
+    if(b->pchdone[cxx] || bd->error) return b->pchtime[cxx];
+    b->pchdone[cxx] = true;
+    char *incl = prj_pch(bd, p, cxx);
+    char *gchf = path_prf(bd, "%s.gch", incl);
+    char *depf = path_prf(bd, "%s.d", incl);
+    if(!gchf || !depf) BD_ERR(bd, 0, "Failed to name the precompiled header");
+    DepLog *log = deplog_get(bd, p->objd);
+    char *cc = static_cc_cxx(bd, p, gchf, p->pch);
+    if(!cc) BD_ERR(bd, 0, "Failed to create compile command");
+    uint64_t sig = hash_data(cc, strlen(cc));
+    free(cc);
+    if(obj_changed(bd, log, gchf, p->pch, depf, modtime(bd, gchf), sig)) {
+        compile(bd, p, -1, gchf, p->pch, depf);
+        for(bool running = true; running && !bd->error; ) {
+            running = false;
+            for(int k = 0; k < bd->running; k++) running |= (bd->job[k].objf == gchf);
+            if(running) job_wait(bd);
+        }
+    }
+    b->pchtime[cxx] = modtime(bd, gchf);
+    return b->pchtime[cxx];
+}
+
+/* every object of the project and every project it links against are done */
+static void build_link(Bd *bd, int i)
+{
+    Prj *p = &bd->prj[i];
+    Build *b = &bd->builds[i];
+    StrArr *srcfs = b->units ? b->units : prj_srcfs(bd, p);
+    b->started = true;
+    DepLog *log = deplog_get(bd, p->objd);
+    /* get most recent modified time of any included library */
+    uint64_t m_llibs = modlibs(bd, p->llibs);
+    for(int k = 0; k < b->targets->n && !bd->error; k++) {
+        char *targetstr = path_prf(bd, "%s%s", b->targets->s[k], static_ext[p->type]);
+        uint64_t m_target = targetstr ? modtime(bd, targetstr) : 0;
+        int libschanged = m_target ? deplog_check(bd, log, targetstr, m_target, true) : -1;
+        b->newlinks[k] |= libschanged < 0 ? (bool)(m_llibs > m_target) : (bool)libschanged;
+    }
+    /* not linked until every link job has been started */
+    b->linking++;
+    bd->cc_cxx = static_cc_def;
+    bd->use_cxx = false;
+    strarr_free(&bd->ofiles);
+    if(p->type == BUILD_EXAMPLES) {
+        for(int k = 0; k < b->targets->n && !bd->error; k++) {
+            if(!strarr_push(bd, &bd->ofiles, b->objfs->s[k])) break;
+            verify_cc_cxx(bd, p, srcfs->s[k]);
+            for(int j = b->targets->n; j < b->objfs->n && !bd->error; j++) {
+                if(!strarr_push(bd, &bd->ofiles, b->objfs->s[j])) break;
+                verify_cc_cxx(bd, p, srcfs->s[j]);
             }
-            /* only if we're of type EXAMPLES, link already */
-            if(p->type == BUILD_EXAMPLES) link(bd, p, targets->s[k], false);
+            link_objs(bd, i, b->targets->s[k], !b->newlinks[k] && !b->newlinks[b->targets->n]);
+        }
+    } else {
+        for(int k = 0; k < srcfs->n && !bd->error; k++) verify_cc_cxx(bd, p, srcfs->s[k]);
+        for(int k = 0; k < b->objfs->n && !bd->error; k++) {
+            if(!strarr_push(bd, &bd->ofiles, b->objfs->s[k])) break;
         }
+        link_objs(bd, i, b->targets->s[0], !b->newlinks[0]);
     }
-    if(p->type != BUILD_EXAMPLES) link(bd, p, targets->s[0], !newlink);
-    /* clean up memory used */
-    strarr_free_pa(dirn, diro, srcfs, objfs, depfs, targets);
-    return;
+    if(!--b->linking) build_linked(bd, i);
+}
+
+static void build_linked(Bd *bd, int i)
+{
+    bd->builds[i].linked = true;
+    DepLog *log = deplog_get(bd, bd->prj[i].objd);
+    double t = timer_now();
+    deplog_flush(bd, log, false);
+    if(log) trace(bd, "deps", log->path, t, 0, 0, 0);
+    for(int j = 0; j < bd->nprj; j++) {
+        Build *b = &bd->builds[j];
+        for(int k = 0; k < b->nafter; k++) {
+            if(b->after[k] == i) b->waiting--;
+        }
+    }
+}
+
+/* start linking whatever can be linked now */
+static void build_ready(Bd *bd)
+{
+    char *cc_cxx = bd->cc_cxx;
+    bool use_cxx = bd->use_cxx;
+    /* up to date projects are linked right away and might unblock others */
+    for(bool progress = true; progress && !bd->error; ) {
+        progress = false;
+        for(int i = 0; i < bd->nprj && !bd->error; i++) {
+            Build *b = &bd->builds[i];
+            if(!b->queued || b->started || b->pending || b->compiling || b->waiting) continue;
+            build_link(bd, i);
+            progress = true;
+        }
+    }
+    bd->cc_cxx = cc_cxx;
+    bd->use_cxx = use_cxx;
+}
+
+/* order the projects so that every one comes after those it links against */
+static void build_order(Bd *bd, int *order)
+{
+    /* find out which projects link against each other */
+    for(int i = 0; i < bd->nprj; i++) {
+        Prj *p = &bd->prj[i];
+        Build *b = &bd->builds[i];
+        b->after = malloc(sizeof(*b->after) * bd->nprj);
+        if(!b->after) BD_ERR(bd,, "Failed to allocate build state");
+        for(int j = 0; j < bd->nprj; j++) {
+            if(!prj_links(bd, p, &bd->prj[j])) continue;
+            BD_VERBOSE(bd, "'%s' links after '%s'", p->name, bd->prj[j].name);
+            b->after[b->nafter++] = j;
+        }
+        b->waiting = b->nafter;
+        for(int k = 0; k < p->deps.n; k++) {
+            int j = 0;
+            while(j < bd->nprj && strcmp(p->deps.s[k], bd->prj[j].name ? bd->prj[j].name : "a")) j++;
+            if(j == bd->nprj) BD_ERR(bd,, "Unknown dependency '%s' of '%s'", p->deps.s[k], p->name);
+        }
+    }
+    /* libraries first, so the projects waiting on them can link early */
+    bool *ordered = calloc(bd->nprj, sizeof(*ordered));
+    if(!ordered) BD_ERR(bd,, "Failed to allocate build state");
+    int n = 0;
+    while(n < bd->nprj) {
+        int before = n;
+        for(int i = 0; i < bd->nprj; i++) {
+            Build *b = &bd->builds[i];
+            int k = 0;
+            while(k < b->nafter && ordered[b->after[k]]) k++;
+            if(ordered[i] || k < b->nafter) continue;
+            ordered[i] = true;
+            order[n++] = i;
+        }
+        if(n == before) {
+            free(ordered);
+            BD_ERR(bd,, "Projects depend on each other");
+        }
+    }
+    free(ordered);
+}
+
+/* projects are compiled in parallel, each one is linked as soon as its objects and libraries are */
+static int stale_cmp(const void *a, const void *b)
+{
+    const Stale *x = a, *y = b;
+    if(x->prio != y->prio) return x->prio < y->prio ? 1 : -1;
+    return x->index - y->index;
+}
+
+/* order the stale objects by how long they and the links waiting on them took last time, longest first,
+ * so the slow ones don't get started last while the other jobs sit idle */
+static void build_schedule(Bd *bd, int *order)
+{
+    if(bd->error || !bd->nstale) return;
+    double *tail = calloc(bd->nprj, sizeof(*tail));
+    if(!tail) BD_ERR(bd,, "Failed to allocate build state");
+    /* from the last project linked back to the first, each one's link and the longest chain of links waiting on it */
+    for(int n = bd->nprj - 1; n >= 0; n--) {
+        int i = order[n];
+        Prj *p = &bd->prj[i];
+        Build *b = &bd->builds[i];
+        DepLog *log = deplog_get(bd, p->objd);
+        double link = 0, after = 0;
+        for(int k = 0; b->targets && k < b->targets->n; k++) {
+            char *targetstr = path_prf(bd, "%s%s", b->targets->s[k], static_ext[p->type]);
+            double took = targetstr ? deplog_took(log, targetstr) : 0;
+            if(took > link) link = took;
+        }
+        for(int j = 0; j < bd->nprj; j++) {
+            for(int k = 0; k < bd->builds[j].nafter; k++) {
+                if(bd->builds[j].after[k] == i && tail[j] > after) after = tail[j];
+            }
+        }
+        tail[i] = link + after;
+    }
+    /* objects without a history count as the average one */
+    double sum = 0;
+    int known = 0;
+    for(int q = 0; q < bd->nstale; q++) {
+        Stale *st = &bd->stale[q];
+        st->prio = deplog_took(deplog_get(bd, bd->prj[st->prj].objd), st->objf);
+        sum += st->prio;
+        known += (st->prio > 0);
+    }
+    for(int q = 0; q < bd->nstale; q++) {
+        Stale *st = &bd->stale[q];
+        if(st->prio <= 0 && known) st->prio = sum / known;
+        st->prio += tail[st->prj];
+    }
+    free(tail);
+    qsort(bd->stale, bd->nstale, sizeof(*bd->stale), stale_cmp);
+    BD_VERBOSE(bd, "scheduled %d compiles, %d of them known, longest chain %.3f s", bd->nstale, known, bd->stale[0].prio);
+}
+static void build(Bd *bd)
+{
+    if(!bd) return;
+    if(bd->error) return;
+    bd->builds = calloc(bd->nprj, sizeof(*bd->builds));
+    int *order = malloc(sizeof(*order) * bd->nprj);
+    if(!bd->builds || !order) {
+        free(bd->builds);
+        bd->builds = 0;
+        free(order);
+        BD_ERR(bd,, "Failed to allocate build state");
+    }
+    build_order(bd, order);
+    double t0 = timer_now();
+    for(int i = 0; i < bd->nprj && !bd->error; i++) build_compile(bd, order[i]);
+    /* up to date projects link right away, then the longest chains start first */
+    build_ready(bd);
+    build_schedule(bd, order);
+    for(int q = 0; q < bd->nstale && !bd->error; q++) {
+        Stale *st = &bd->stale[q];
+        bd->cc_cxx = st->cc_cxx;
+        bd->builds[st->prj].pending--;
+        compile(bd, &bd->prj[st->prj], st->k, st->objf, st->srcf, st->depf);
+        /* other projects might have finished in the meantime */
+        build_ready(bd);
+    }
+    bd->nstale = 0;
+    /* link the rest as the jobs finish */
+    while(!bd->error) {
+        build_ready(bd);
+        if(!bd->running) break;
+        job_wait(bd);
+    }
+    job_wait_all(bd);
+    held_flush(bd);
+    if(bd->repeated) BD_MSG(bd, "%zu repeated warning%s left out", bd->repeated, bd->repeated == 1 ? "" : "s");
+    free(bd->seen);
+    bd->seen = 0;
+    bd->nseen = 0;
+    bd->capseen = 0;
+    bd->repeated = 0;
+    /* the build can't be quicker than its longest chain, however many jobs run at once */
+    double critical = 0;
+    double *finish = calloc(bd->nprj, sizeof(*finish));
+    for(int n = 0; finish && n < bd->nprj; n++) {
+        int i = order[n];
+        Build *b = &bd->builds[i];
+        double start = b->compiled;
+        for(int k = 0; k < b->nafter; k++) {
+            if(finish[b->after[k]] > start) start = finish[b->after[k]];
+        }
+        finish[i] = start + b->linktime;
+        if(finish[i] > critical) critical = finish[i];
+    }
+    free(finish);
+    double took = timer_now() - t0;
+    bd->critical += critical;
+    bd->buildtime += took;
+    if(critical > 0) BD_VERBOSE(bd, "critical path %.3f s, the build took %.3f s with %d jobs", critical, took, bd->jobs);
+    for(int i = 0; bd->builds && i < bd->nprj; i++) {
+        Build *b = &bd->builds[i];
+        strarr_free_pa(b->objfs, b->depfs, b->targets, b->units);
+        free(b->newlinks);
+        free(b->after);
+    }
+    free(bd->builds);
+    bd->builds = 0;
+    free(bd->stale);
+    bd->stale = 0;
+    bd->capstale = 0;
+    free(order);
+    strarr_free(&bd->ofiles);
+}
+
+/* expand the patterns without the files in `exclude` (sorted) ; the matches of each pattern are sorted on their own
+ * and follow those of the patterns before it, like the order they're given in */
+static StrArr *prj_glob(Bd *bd, StrArr *pats, StrArr *exclude)
+{
+    StrArr *result = strarr_new();
+    int *start = malloc(sizeof(*start) * (pats->n + 1));
+    if(!result || !start) {
+        strarr_free_p(result);
+        free(start);
+        BD_ERR(bd, 0, "Failed to create StrArr");
+    }
+    for(int k = 0; k < pats->n && !bd->error; k++) {
+        int n0 = start[k] = result->n;
+        char *pat = pats->s[k];
+        glob_dir(bd, (*pat == '/' || *pat == SLASH_STR[0]) ? SLASH_STR : "", pat, result);
+        BD_VERBOSE(bd, "pattern '%s' matched %d files", pat, result->n - n0);
+        /* sort and remove duplicates, also those an earlier pattern matched ; interned paths are equal by pointer */
+        if(result->n > n0) qsort(&result->s[n0], result->n - n0, sizeof(*result->s), strarr_cmp);
+        int n = n0;
+        for(int i = n0, j = 0; i < result->n; i++) {
+            if(n > n0 && result->s[n - 1] == result->s[i]) continue;
+            while(exclude && j < exclude->n && strarr_cmp(&exclude->s[j], &result->s[i]) < 0) j++;
+            if(exclude && j < exclude->n && exclude->s[j] == result->s[i]) continue;
+            bool seen = false;
+            for(int m = 0; m < k && !seen; m++) seen = bsearch(&result->s[i], &result->s[start[m]], start[m + 1] - start[m], sizeof(*result->s), strarr_cmp);
+            if(!seen) result->s[n++] = result->s[i];
+        }
+        result->n = start[k + 1] = n;
+    }
+    free(start);
+    return result;
 }
 
+/* the expanded source files belong to the project, don't free them */
 static StrArr *prj_srcfs(Bd *bd, Prj *p)
 {
-    StrArr *result = 0;
-    for(int k = 0; k < p->srcf.n && !bd->error; k++) {
-        char *cmd = strprf(0, FIND(p->srcf.s[k]));
-        BD_VERBOSE(bd, "Pass to pipe: %s", cmd);
-        bool state = parse_pipe(bd, cmd, &result);
-        if(!state) BD_ERR(bd, 0, "Pipe returned nothing");
-        free(cmd);
+    if(p->srcfs) return p->srcfs;
+    double t = timer_now();
+    /* support sources of examples aren't examples themselves */
+    StrArr *supfs = p->type == BUILD_EXAMPLES ? prj_supfs(bd, p) : 0;
+    StrArr *result = prj_glob(bd, &p->srcf, supfs);
+    if(!result) return 0;
+    if(!result->n || bd->error) {
+        strarr_free_p(result);
+        return 0;
     }
+    p->srcfs = result;
+    trace(bd, "glob", p->name ? p->name : "a", t, 0, 0, 0);
     return result;
 }
+
+static StrArr *prj_supfs(Bd *bd, Prj *p)
+{
+    if(!p->supfs) p->supfs = prj_glob(bd, &p->supf, 0);
+    return p->supfs;
+}
 static StrArr *prj_names(Bd *bd, Prj *p, StrArr *srcfs)
 {
     StrArr *result = strarr_new();
     if(!result) BD_ERR(bd, 0, "Failed to create StrArr");
     /* only if we're not dealing with examples, the name is simple */
     if(p->type != BUILD_EXAMPLES) {
-        if(!strarr_set_n(result, result->n + 1)) BD_ERR(bd, 0, "Failed to modify StrArr");
-        result->s[result->n - 1] = strprf(0, "%s", p->name ? p->name : "a");
+        if(!strarr_push(bd, result, path_prf(bd, "%s", p->name ? p->name : "a"))) return result;
     } else {
         for(int i = 0; i < srcfs->n; i++) {
             int ext = strrstr(srcfs->s[i], ".");
             int dir = strrstr(srcfs->s[i], SLASH_STR);
             /* add to result */
-            if(!strarr_set_n(result, result->n + 1)) BD_ERR(bd, 0, "Failed to modify StrArr");
-            result->s[result->n - 1] = strprf(0, "%s%s%.*s", p->name ? p->name : "", p->name ? SLASH_STR : "", ext - dir - 1, &srcfs->s[i][dir + 1]);
+            if(!strarr_push(bd, result, path_prf(bd, "%s%s%.*s", p->name ? p->name : "", p->name ? SLASH_STR : "", ext - dir - 1, &srcfs->s[i][dir + 1]))) break;
         }
     }
     return result;
@@ -706,20 +3649,155 @@ static StrArr *prj_srcfs_chg_dirext(Bd *bd, StrArr *srcfs, char *new_dir, char *
     for(int i = 0; i < srcfs->n; i++) {
         int ext = strrstr(srcfs->s[i], ".");
         int slash = strrstr(srcfs->s[i], SLASH_STR);
-        result->s[i] = strprf(0, "%s%s%.*s%s", new_dir ? new_dir : "", new_dir ? SLASH_STR : "", ext - slash - 1, &srcfs->s[i][slash + 1], new_ext);
+        result->s[i] = path_prf(bd, "%s%s%.*s%s", new_dir ? new_dir : "", new_dir ? SLASH_STR : "", ext - slash - 1, &srcfs->s[i][slash + 1], new_ext);
+        if(!result->s[i]) {
+            strarr_free_p(result);
+            return 0;
+        }
     }
     return result;
 }
 
-static void delete_cmd(Bd *bd, char *target, char *to_delete, bool folder)
+static bool src_is_cxx(const char *filename)
+{
+    size_t len = strlen(filename);
+    return (len > 3 && !strcmp(&filename[len - 3], ".cc")) || (len > 4 && !strcmp(&filename[len - 4], ".cpp"));
+}
+
+/* each unity file includes a batch of p->unity sources, C and C++ ones separately ;
+ * the result lists them first (*batches of them), followed by the sources split out of their batch.
+ * a split out source leaves a gap in its batch, so the other batches keep their members */
+static StrArr *prj_unity(Bd *bd, Prj *p, StrArr *srcfs, bool generate, int *batches)
 {
-    char *delstr = strprf(0, "%s %s %s", folder ? delfoldstr : delfilestr, to_delete, noerr);
-    BD_MSG(bd, "\033[95;1m[ %s ]\033[0m %s", target, delstr); /* bright magenta */
-    int result = system(delstr);
-    if(result == -1) BD_ERR(bd,, "System failed deleting %s", folder ? "folder(s)" : "file(s)");
-    free(delstr);
+    StrArr *result = strarr_new();
+    if(!result) BD_ERR(bd, 0, "Failed to create StrArr");
+    char *objd = p->objd ? p->objd : "";
+    char *slash = p->objd ? SLASH_STR : "";
+    char *listf = path_prf(bd, "%s%s.bd.unity", objd, slash);
+    /* the sources split out so far, one per line */
+    StrArr split = {0};
+    char *list = listf ? read_file(bd, listf, 0) : 0;
+    for(char *line = list; line && *line; ) {
+        size_t n = strcspn(line, "\r\n");
+        if(n) strarr_push(bd, &split, path_intern(bd, line, n));
+        line += n;
+        line += strspn(line, "\r\n");
+    }
+    free(list);
+    bool splitchanged = false;
+    /* the unity files include the sources relative to themselves */
+    Str prefix = {0};
+    bool outside = !*objd || *objd == '/' || strstr(objd, "..") || strchr(objd, ':');
+    if(p->objd && outside) {
+        char cwd[4096] = {0};
+#if defined(OS_WIN)
+        GetCurrentDirectoryA(sizeof(cwd), cwd);
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+        if(!getcwd(cwd, sizeof(cwd))) cwd[0] = 0;
+#endif
+        str_app(&prefix, "%s/", cwd);
+    } else {
+        for(char *c = objd; *c; c++) {
+            if((c == objd || c[-1] == '/' || c[-1] == '\\') && *c != '/' && *c != '\\') str_app(&prefix, "../");
+        }
+    }
+    int nbatch = 0;
+    Str content = {0};
+    for(int cxx = 0; cxx < 2 && !bd->error; cxx++) {
+        int n = 0;
+        for(int i = 0; i < srcfs->n && !bd->error; i++) {
+            if(src_is_cxx(srcfs->s[i]) != (bool)cxx) continue;
+            if(n++ % p->unity) continue;
+            /* a batch starts here and covers the next p->unity sources of the same language, [i, iE) */
+            int iE = i;
+            for(int m = 0; iE < srcfs->n && m < p->unity; iE++) {
+                if(src_is_cxx(srcfs->s[iE]) == (bool)cxx) m++;
+            }
+            char *unityf = path_prf(bd, "%s%sunity_%d%s", objd, slash, nbatch, cxx ? ".cpp" : ".c");
+            char *unityo = path_prf(bd, "%s%sunity_%d.o", objd, slash, nbatch);
+            if(!unityf || !unityo) break;
+            nbatch++;
+            /* split out a source only if it's the one change in its batch */
+            uint64_t m_obj = (generate && p->unity_split) ? modtime(bd, unityo) : 0;
+            char *changed = 0;
+            int nchanged = 0;
+            for(int j = i; j < iE && m_obj; j++) {
+                if(src_is_cxx(srcfs->s[j]) != (bool)cxx) continue;
+                bool issplit = false;
+                for(int k = 0; k < split.n; k++) issplit |= (split.s[k] == srcfs->s[j]);
+                if(issplit || modtime(bd, srcfs->s[j]) <= m_obj) continue;
+                changed = srcfs->s[j];
+                nchanged++;
+            }
+            if(nchanged == 1 && strarr_push(bd, &split, changed)) {
+                BD_VERBOSE(bd, "split '%s' out of '%s'", changed, unityf);
+                splitchanged = true;
+            }
+            content.len = 0;
+            str_app(&content, "/* generated by bd */\n");
+            int members = 0;
+            for(int j = i; j < iE; j++) {
+                if(src_is_cxx(srcfs->s[j]) != (bool)cxx) continue;
+                bool issplit = false;
+                for(int k = 0; k < split.n; k++) issplit |= (split.s[k] == srcfs->s[j]);
+                if(issplit) continue;
+                bool absolute = srcfs->s[j][0] == '/' || (srcfs->s[j][0] && srcfs->s[j][1] == ':');
+                str_app(&content, "#include \"%s%s\"\n", absolute || !prefix.s ? "" : prefix.s, srcfs->s[j]);
+                members++;
+            }
+            if(!members) continue;
+            /* rewriting an unchanged batch would compile all of it again */
+            char *old = generate ? read_file(bd, unityf, 0) : 0;
+            if(generate && (!old || strcmp(old, content.s))) {
+                FILE *fp = fopen(unityf, "wb");
+                if(!fp || fwrite(content.s, 1, content.len, fp) != content.len) bd->error = __LINE__;
+                if(fp && fclose(fp)) bd->error = __LINE__;
+                statcache_forget(bd, unityf);
+                BD_VERBOSE(bd, "wrote '%s' with %d sources", unityf, members);
+            }
+            free(old);
+            strarr_push(bd, result, unityf);
+        }
+    }
+    if(batches) *batches = result->n;
+    /* then the split out sources that are still around */
+    for(int k = 0; k < split.n; k++) {
+        for(int i = 0; i < srcfs->n; i++) {
+            if(srcfs->s[i] == split.s[k]) strarr_push(bd, result, split.s[k]);
+        }
+    }
+    if(generate && splitchanged && !bd->error) {
+        FILE *fp = fopen(listf, "wb");
+        for(int k = 0; fp && k < split.n; k++) fprintf(fp, "%s\n", split.s[k]);
+        if(!fp || fclose(fp)) bd->error = __LINE__;
+    }
+    str_free(&prefix);
+    str_free(&content);
+    strarr_free(&split);
+    if(bd->error) {
+        strarr_free_p(result);
+        BD_ERR(bd, 0, "Could not write the unity files in '%s'", objd);
+    }
+    return result;
 }
 
+/* remove the files, or the empty folders, right here ; returns how many got removed */
+static int delete_paths(Bd *bd, StrArr *paths, bool folder)
+{
+    int removed = 0;
+    for(int i = 0; i < paths->n; i++) {
+#if defined(OS_WIN)
+        bool ok = folder ? (bool)RemoveDirectoryA(paths->s[i]) : !remove(paths->s[i]);
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+        bool ok = !(folder ? rmdir(paths->s[i]) : unlink(paths->s[i]));
+#endif
+        if(!ok) continue;
+        statcache_forget(bd, paths->s[i]);
+        BD_VERBOSE(bd, "removed '%s'", paths->s[i]);
+        removed++;
+    }
+    return removed;
+}
 static void clean(Bd *bd, Prj *p)
 {
     if(bd->error) return;
@@ -728,66 +3806,677 @@ static void clean(Bd *bd, Prj *p)
     if(!dirn) BD_ERR(bd,, "Failed to get directories from name");
     StrArr *diro = extract_dirs(bd, p->objd, false);
     if(!diro) BD_ERR(bd,, "Failed to get directories from objd");
+    /* with every source gone there's just nothing to expand, what was built is still found below */
+    StrArr none = {0};
     StrArr *srcfs = prj_srcfs(bd, p);
-    if(!srcfs) BD_ERR(bd,, "No source files");
-    StrArr *objfs = prj_srcfs_chg_dirext(bd, srcfs, p->objd, ".o");
+    if(bd->error) return;
+    if(!srcfs) srcfs = &none;
+    StrArr *objfs = srcfs->n ? prj_srcfs_chg_dirext(bd, srcfs, p->objd, ".o") : strarr_new();
     if(!objfs) BD_ERR(bd,, "No object files");
-    StrArr *depfs = prj_srcfs_chg_dirext(bd, srcfs, p->objd, ".d");
+    StrArr *depfs = srcfs->n ? prj_srcfs_chg_dirext(bd, srcfs, p->objd, ".d") : strarr_new();
     if(!depfs) BD_ERR(bd,, "No dependency files");
     StrArr *targets = prj_names(bd, p, srcfs);
     if(!targets) BD_ERR(bd,, "No targets to build");
-    /* delete all files */
-    for(int k = 0; k < targets->n; k++) {
-        /* maybe check if target even exists */
-        char *targetstr = strprf(0, "%s%s", targets->s[k], static_ext[p->type]);
-        char *delfiles = strprf(0, "\"%s\" ", targetstr);
-        char *delfolds = 0;
-        free(targetstr);
-        /* set up loop */
-        int i0 = (p->type == BUILD_EXAMPLES) ? k : 0;
-        int iE = (p->type == BUILD_EXAMPLES) ? k + 1 : srcfs->n;
-        for(int i = i0; i < iE; i++) delfiles = strprf(delfiles, "\"%s\" \"%s\" ", objfs->s[i], depfs->s[i]);
-        for(int i = dirn->n - 1; i + 1 > 0; i--) delfolds = strprf(delfolds, "\"%s\" ", dirn->s[i]);
-        for(int i = diro->n - 1; i + 1 > 0; i--) delfolds = strprf(delfolds, "\"%s\" ", diro->s[i]);
-        /* now delete */
-        delete_cmd(bd, targets->s[k], delfiles, false);
-        delete_cmd(bd, targets->s[k], delfolds, true);
-        free(delfiles);
-        free(delfolds);
+    /* compiled besides the sources: unity files, or support sources of examples */
+    bool unity = p->unity > 0 && p->type != BUILD_EXAMPLES;
+    int batches = 0;
+    StrArr *units = unity ? prj_unity(bd, p, srcfs, false, &batches) : prj_glob(bd, &p->supf, 0);
+    if(!units) BD_ERR(bd,, "No unity or support files");
+    StrArr *unitso = units->n ? prj_srcfs_chg_dirext(bd, units, p->objd, ".o") : strarr_new();
+    StrArr *unitsd = units->n ? prj_srcfs_chg_dirext(bd, units, p->objd, ".d") : strarr_new();
+    if(!unitso || !unitsd) BD_ERR(bd,, "No unity or support files");
+    /* split out sources of unity builds already are in objfs */
+    int nunits = unity ? batches : units->n;
+    char *objd = p->objd ? p->objd : "";
+    char *sep = p->objd ? SLASH_STR : "";
+    /* list all files */
+    StrArr files = {0}, folders = {0};
+    bool listed = strarr_push(bd, &files, path_prf(bd, "%s%s.bd.deps", objd, sep));
+    for(int k = 0; k < targets->n && listed; k++) listed = strarr_push(bd, &files, path_prf(bd, "%s%s", targets->s[k], static_ext[p->type]));
+    for(int i = 0; i < srcfs->n && listed; i++) listed = strarr_push(bd, &files, objfs->s[i]) && strarr_push(bd, &files, depfs->s[i]);
+    for(int i = 0; i < batches && listed; i++) listed = strarr_push(bd, &files, units->s[i]);
+    for(int i = 0; i < nunits && listed; i++) listed = strarr_push(bd, &files, unitso->s[i]) && strarr_push(bd, &files, unitsd->s[i]);
+    for(int cxx = 0; cxx < 2 && p->pch && listed; cxx++) listed = strarr_push(bd, &files, path_prf(bd, "%s.gch", prj_pch(bd, p, cxx))) && strarr_push(bd, &files, path_prf(bd, "%s.d", prj_pch(bd, p, cxx)));
+    if(unity && listed) listed = strarr_push(bd, &files, path_prf(bd, "%s%s.bd.unity", objd, sep));
+    /* whatever earlier builds made, e.g. objects of sources deleted since */
+    DepLog *log = deplog_get(bd, p->objd);
+    for(uint32_t id = 0; log && id < log->nstr && listed; id++) {
+        DepObj *o = &log->obj[id];
+        if(!o->known && !o->sig && !o->ms) continue;
+        char *key = log->str[id];
+        listed = strarr_push(bd, &files, path_intern(bd, key, strlen(key)));
+        /* objects and precompiled headers come with their dependency file */
+        char *ext = strrchr(key, '.');
+        if(listed && ext && (!strcmp(ext, ".o") || !strcmp(ext, ".gch"))) listed = strarr_push(bd, &files, path_prf(bd, "%.*s.d", (int)(ext - key), key));
+    }
+    /* and objects in objd that came with a dependency file, e.g. of builds from before the log */
+    DIR *dp = p->objd ? opendir(p->objd) : 0;
+    for(struct dirent *entry = dp ? readdir(dp) : 0; entry && listed; entry = readdir(dp)) {
+        char *ext = strrchr(entry->d_name, '.');
+        if(!ext || strcmp(ext, ".o")) continue;
+        char *depf = path_prf(bd, "%s%s%.*s.d", objd, sep, (int)(ext - entry->d_name), entry->d_name);
+        if(!modtime(bd, depf)) continue;
+        listed = strarr_push(bd, &files, path_prf(bd, "%s%s%s", objd, sep, entry->d_name)) && strarr_push(bd, &files, depf);
+    }
+    if(dp) closedir(dp);
+    for(int i = dirn->n - 1; i + 1 > 0 && listed; i--) listed = strarr_push(bd, &folders, dirn->s[i]);
+    for(int i = diro->n - 1; i + 1 > 0 && listed; i--) listed = strarr_push(bd, &folders, diro->s[i]);
+    /* now delete */
+    if(listed) {
+        int nfiles = delete_paths(bd, &files, false);
+        int nfolders = delete_paths(bd, &folders, true);
+        BD_MSG(bd, "\033[95;1m[ %s ]\033[0m removed %d files and %d folders", p->name ? p->name : "a", nfiles, nfolders); /* bright magenta */
     }
+    strarr_free(&files);
+    strarr_free(&folders);
+    deplog_drop(bd, p->objd);
     /* clean up memory used */
-    strarr_free_pa(dirn, diro, srcfs, objfs, depfs, targets);
+    strarr_free_pa(dirn, diro, objfs, depfs, targets, units, unitso, unitsd);
+    if(!listed) BD_ERR(bd,, "Failed to list files to delete");
 }
 
-static void bd_execute(Bd *bd, CmdList cmd)
+static void watch_file(Bd *bd, Watch *w, const char *path)
 {
-    Prj p[] = {
-#include CONFIG
+    StatEntry *entry = statcache_get(bd, path);
+    if(!entry || entry->watched) return;
+    entry->watched = true;
+    w->files++;
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+    if(w->fd < 0) return;
+    /* editors tend to replace files instead of writing them, so watch the folders */
+    char *slash = strrchr(entry->path, '/');
+    char *dir = path_intern(bd, entry->path, slash ? slash - entry->path + 1 : 0);
+    if(!dir) return;
+    for(int i = 0; i < w->dirs.n; i++) {
+        if(w->dirs.s[i] == dir) return;
+    }
+    int wd = inotify_add_watch(w->fd, *dir ? dir : ".", IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO);
+    if(wd < 0) {
+        BD_VERBOSE(bd, "could not watch '%s': %s", dir, strerror(errno));
+        return;
+    }
+    if(wd >= w->dirs.n && !strarr_set_n(&w->dirs, wd + 1)) BD_ERR(bd,, "Failed to modify StrArr");
+    w->dirs.s[wd] = dir;
+#endif
+}
+
+/* every source, header and library of the last build */
+static void watch_register(Bd *bd, Watch *w)
+{
+    for(int i = 0; i < bd->nprj; i++) {
+        StrArr *srcfs = prj_srcfs(bd, &bd->prj[i]);
+        for(int k = 0; srcfs && k < srcfs->n; k++) watch_file(bd, w, srcfs->s[k]);
+        StrArr *libs = libpaths(bd, bd->prj[i].llibs);
+        for(int k = 0; libs && k < libs->n; k++) watch_file(bd, w, libs->s[k]);
+        strarr_free_p(libs);
+    }
+    for(DepLog *log = bd->logs; log; log = log->next) {
+        for(uint32_t i = 0; i < log->nstr; i++) {
+            DepObj *o = &log->obj[i];
+            if(!o->known) continue;
+            for(uint32_t j = 0; j < o->n; j++) watch_file(bd, w, log->str[deplog_u32((char *)o->ents + j * DEPLOG_ENT)]);
+        }
+    }
+    /* bd's own outputs would trigger endless rebuilds */
+    for(int i = 0; i < bd->nprj; i++) {
+        Prj *p = &bd->prj[i];
+        StrArr *srcfs = prj_srcfs(bd, p);
+        StrArr *targets = srcfs ? prj_names(bd, p, srcfs) : 0;
+        for(int k = 0; targets && k < targets->n; k++) {
+            StatEntry *entry = statcache_get(bd, path_prf(bd, "%s%s", targets->s[k], static_ext[p->type]));
+            if(!entry || !entry->watched) continue;
+            entry->watched = false;
+            w->files--;
+        }
+        strarr_free_p(targets);
+    }
+}
+
+/* blocks until something changed, false if watching failed */
+static bool watch_wait(Bd *bd, Watch *w)
+{
+    StatCache *sc = &bd->stats;
+    bool changed = false;
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+    if(w->fd >= 0) {
+        char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        int timeout = -1;
+        /* after the first change, wait until the editor is done writing */
+        for(;;) {
+            struct pollfd pfd = {.fd = w->fd, .events = POLLIN};
+            int ready = poll(&pfd, 1, timeout);
+            if(ready < 0 && errno == EINTR) continue;
+            if(ready < 0) BD_ERR(bd, false, "Failed to wait for changes: %s", strerror(errno));
+            if(!ready) break;
+            ssize_t len = read(w->fd, buf, sizeof(buf));
+            if(len < 0 && errno == EINTR) continue;
+            if(len <= 0) BD_ERR(bd, false, "Failed to read changes: %s", strerror(errno));
+            for(char *ptr = buf; ptr < buf + len; ) {
+                struct inotify_event *ev = (struct inotify_event *)ptr;
+                ptr += sizeof(*ev) + ev->len;
+                if(ev->mask & IN_Q_OVERFLOW) {
+                    /* lost track, look at everything again */
+                    for(size_t i = 0; i < sc->cap; i++) sc->e[i].stale = true;
+                    w->rescan = true;
+                    changed = true;
+                    continue;
+                }
+                if(ev->wd < 0 || ev->wd >= w->dirs.n || !w->dirs.s[ev->wd] || !ev->len) continue;
+                Str *path = &bd->scratch;
+                path->len = 0;
+                if(!str_app(path, "%s%s", w->dirs.s[ev->wd], ev->name)) BD_ERR(bd, false, "Failed to format path");
+                StatEntry *entry = statcache_find(sc, path->s);
+                if(entry->path && entry->watched) {
+                    BD_VERBOSE(bd, "'%s' changed", entry->path);
+                    entry->stale = true;
+                    changed = true;
+                }
+                /* only the patterns can tell if a new file belongs to a project */
+                size_t n = strlen(ev->name);
+                bool source = (n > 2 && !strcmp(&ev->name[n - 2], ".c")) || (n > 3 && !strcmp(&ev->name[n - 3], ".cc")) || (n > 4 && !strcmp(&ev->name[n - 4], ".cpp"));
+                if(source && (ev->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))) {
+                    w->rescan = true;
+                    changed = true;
+                }
+            }
+            if(changed) timeout = 50;
+        }
+        return true;
+    }
+#endif
+    /* no notifications, compare the times every now and then */
+    while(!changed) {
+#if defined(OS_WIN)
+        Sleep(500);
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+        usleep(500000);
+#endif
+        for(size_t i = 0; i < sc->cap; i++) {
+            StatEntry *entry = &sc->e[i];
+            if(!entry->path || !entry->watched) continue;
+            if(modtime_stat(bd, entry->path) == entry->time) continue;
+            BD_VERBOSE(bd, "'%s' changed", entry->path);
+            entry->stale = true;
+            changed = true;
+        }
+    }
+    return true;
+}
+
+/* everything found so far stays in memory, only what changed gets looked at again */
+static void watch(Bd *bd)
+{
+    Watch w = {.fd = -1};
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+    w.fd = inotify_init1(IN_CLOEXEC);
+    if(w.fd < 0) BD_VERBOSE(bd, "inotify is not available, polling instead: %s", strerror(errno));
+#endif
+    for(;;) {
+        if(w.rescan) {
+            for(int i = 0; i < bd->nprj; i++) {
+                strarr_free_p(bd->prj[i].srcfs);
+                strarr_free_p(bd->prj[i].supfs);
+            }
+            w.rescan = false;
+        }
+        build(bd);
+        /* a failed build is fixed by the next change */
+        bd->error = 0;
+        watch_register(bd, &w);
+        BD_MSG(bd, "\033[1m[ watch ]\033[0m %zu files, waiting for changes", w.files);
+        fflush(stdout);
+        if(!watch_wait(bd, &w)) break;
+    }
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+    if(w.fd >= 0) close(w.fd);
+#endif
+    strarr_free(&w.dirs);
+}
+
+/* user and system time of bd itself in seconds */
+static double cpu_time(void)
+{
+#if defined(OS_WIN)
+    FILETIME creation, exit, kernel, user;
+    if(!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) return 0;
+    ULARGE_INTEGER k = {.HighPart = kernel.dwHighDateTime, .LowPart = kernel.dwLowDateTime};
+    ULARGE_INTEGER u = {.HighPart = user.dwHighDateTime, .LowPart = user.dwLowDateTime};
+    return (double)(k.QuadPart + u.QuadPart) * 1e-7;
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    struct rusage usage = {0};
+    getrusage(RUSAGE_SELF, &usage);
+    return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+/* remember a step that began at `start` and ends now */
+static void trace(Bd *bd, const char *cat, const char *name, double start, int lane, double cpu, size_t rss)
+{
+    if(!bd->trace) return;
+    double now = timer_now();
+    if(bd->nevents >= bd->capevents) {
+        size_t cap = bd->capevents ? bd->capevents * 2 : 256;
+        void *temp = realloc(bd->events, sizeof(*bd->events) * cap);
+        if(!temp) BD_ERR(bd,, "Failed to grow the trace");
+        bd->events = temp;
+        bd->capevents = cap;
+    }
+    bd->events[bd->nevents++] = (TraceEvent){
+        .cat = cat,
+        .name = path_intern(bd, name, strlen(name)),
+        .start = start - bd->t0,
+        .wall = now - start,
+        .cpu = cpu,
+        .rss = rss,
+        .lane = lane,
     };
+}
+
+static void json_str(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+    for(; s && *s; s++) {
+        if(*s == '"' || *s == '\\') fprintf(fp, "\\%c", *s);
+        else if((unsigned char)*s < 0x20) fprintf(fp, "\\u%04x", *s);
+        else fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+/* slowest first */
+static int trace_cmp(const void *a, const void *b)
+{
+    const TraceEvent *ea = *(TraceEvent **)a;
+    const TraceEvent *eb = *(TraceEvent **)b;
+    return (ea->wall < eb->wall) - (ea->wall > eb->wall);
+}
+
+/* the timeline in the chrome trace event format and a summary of where the time went */
+static void trace_write(Bd *bd)
+{
+    if(!bd->trace) return;
+    double wall = timer_now() - bd->t0;
+    FILE *fp = fopen(bd->trace, "wb");
+    if(!fp) BD_ERR(bd,, "Could not write '%s'", bd->trace);
+    fprintf(fp, "{\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"bd\"}}");
+    for(size_t i = 0; i < bd->nevents; i++) {
+        TraceEvent *e = &bd->events[i];
+        fprintf(fp, ",\n{\"name\":");
+        json_str(fp, e->name);
+        fprintf(fp, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.0f,\"dur\":%.0f", e->cat, e->lane, e->start * 1e6, e->wall * 1e6);
+        if(e->lane) fprintf(fp, ",\"args\":{\"cpu_ms\":%.1f,\"max_rss_kib\":%zu}", e->cpu * 1e3, e->rss);
+        fprintf(fp, "}");
+    }
+    fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    if(fclose(fp)) BD_ERR(bd,, "Could not write '%s'", bd->trace);
+    if(bd->quiet) return;
+    /* slowest translation units */
+    TraceEvent **tus = malloc(sizeof(*tus) * (bd->nevents + 1));
+    if(!tus) BD_ERR(bd,, "Failed to summarize the trace");
+    size_t ntus = 0;
+    for(size_t i = 0; i < bd->nevents; i++) {
+        if(!strcmp(bd->events[i].cat, "compile")) tus[ntus++] = &bd->events[i];
+    }
+    qsort(tus, ntus, sizeof(*tus), trace_cmp);
+    printf("\033[1m[ trace ]\033[0m %s\n", bd->trace);
+    if(ntus) printf("%2s%9s %9s %9s  %s\n", "", "wall s", "cpu s", "rss MiB", "slowest translation units");
+    for(size_t i = 0; i < ntus && i < 10; i++) {
+        printf("%2s%9.3f %9.3f %9.1f  %s\n", "", tus[i]->wall, tus[i]->cpu, (double)tus[i]->rss / 1024, tus[i]->name);
+    }
+    free(tus);
+    /* totals per kind of step */
+    const char *cats[] = {"compile", "archive", "link", "cache", "glob", "parse", "check", "deps"};
+    double jobs = 0;
+    printf("%2s%9s %9s %9s  %s\n", "", "wall s", "cpu s", "steps", "total");
+    for(size_t c = 0; c < SIZE_ARRAY(cats); c++) {
+        double sum = 0, cpu = 0;
+        size_t n = 0;
+        for(size_t i = 0; i < bd->nevents; i++) {
+            if(strcmp(bd->events[i].cat, cats[c])) continue;
+            sum += bd->events[i].wall;
+            cpu += bd->events[i].cpu;
+            n++;
+        }
+        if(c < 3) jobs += cpu;
+        if(n) printf("%2s%9.3f %9.3f %9zu  %s\n", "", sum, cpu, n, cats[c]);
+    }
+    printf("%2sbd itself used %.3f s cpu, the compilers and linkers %.3f s cpu, within %.3f s\n", "", cpu_time(), jobs, wall);
+    if(bd->critical > 0) printf("%2sthe longest chain of compiles and links took %.3f s, the builds %.3f s (%.0f%%)\n", "", bd->critical, bd->buildtime, 100 * bd->critical / bd->buildtime);
+}
+
+/* monotonic time in seconds */
+static double timer_now(void)
+{
+#if defined(OS_WIN)
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+/* parse a dependency file as big as the ones of heavy C++ translation units */
+static void bench_dfile(Bd *bd, bool crlf)
+{
+    const int headers = 5000;
+    char *path = ".bd_bench.d";
+    char *nl = crlf ? "\r\n" : "\n";
+    FILE *fp = fopen(path, "wb");
+    if(!fp) BD_ERR(bd,, "Could not create '%s'", path);
+    fprintf(fp, "obj/bench.o: src/bench.cpp \\%s", nl);
+    for(int i = 0; i < headers; i++) {
+        fprintf(fp, " /usr/include/boost/mpl/aux_/preprocessed/gcc/%s%d.hpp \\%s", i % 50 ? "header_" : "with\\ space_", i, nl);
+    }
+    fprintf(fp, " src/bench.h%s%s", nl, nl);
+    for(int i = 0; i < headers; i++) {
+        fprintf(fp, "/usr/include/boost/mpl/aux_/preprocessed/gcc/%s%d.hpp:%s%s", i % 50 ? "header_" : "with\\ space_", i, nl, nl);
+    }
+    long size = ftell(fp);
+    fclose(fp);
+    int runs = 0;
+    double t0 = timer_now(), elapsed = 0;
+    while(!bd->error && (runs < 10 || elapsed < 0.5)) {
+        DepFile *df = parse_dfile(bd, path);
+        int n = df ? df->n : 0;
+        depfile_free(df);
+        if(n != headers + 1) {
+            remove(path);
+            BD_ERR(bd,, "Parsed %d instead of %d headers", n, headers + 1);
+        }
+        runs++;
+        elapsed = timer_now() - t0;
+    }
+    remove(path);
+    printf("{\"bench\":\"dfile_%s\",\"headers\":%d,\"bytes\":%ld,\"runs\":%d,\"seconds\":%.6f,\"mb_per_s\":%.1f}\n",
+            crlf ? "crlf" : "lf", headers + 1, size, runs, elapsed, (double)size * runs / elapsed / 1e6);
+}
+
+static bool bench_spec(Bd *bd, const char *arg, BenchSpec *spec)
+{
+    while(arg && *arg) {
+        char key[32] = {0};
+        int val = 0, len = 0;
+        if(sscanf(arg, "%31[^=,]=%d%n", key, &val, &len) != 2 || val < 0) BD_ERR(bd, false, "Invalid benchmark parameter '%s'", arg);
+        if(!strcmp(key, "files") && val > 0) spec->files = val;
+        else if(!strcmp(key, "headers") && val > 0) spec->headers = val;
+        else if(!strcmp(key, "includes")) spec->includes = val;
+        else if(!strcmp(key, "fanout")) spec->fanout = val;
+        else if(!strcmp(key, "projects") && val > 0) spec->projects = val;
+        else if(!strcmp(key, "runs") && val > 0) spec->runs = val;
+        else BD_ERR(bd, false, "Invalid benchmark parameter '%s'", key);
+        arg += len;
+        if(*arg == ',') arg++;
+    }
+    return true;
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+/* headers only include headers after them, so there are no cycles */
+static int bench_child(BenchSpec *spec, int h, int f)
+{
+    int after = spec->headers - h - 1;
+    return after > 0 ? h + 1 + (h * 31 + f * 17) % after : -1;
+}
+
+/* writes sources, headers and the stub compiler and archiver into the current folder ;
+ * returns the header included by the median number of sources */
+static char *bench_generate(Bd *bd, BenchSpec *spec, Prj *prjs)
+{
+    const BuildList types[] = {BUILD_STATIC, BUILD_SHARED, BUILD_APP, BUILD_EXAMPLES};
+    FILE *fp = fopen("stub.sh", "wb");
+    if(!fp) BD_ERR(bd, 0, "Could not create the stub compiler");
+    /* the dependency file the compiler would write is generated beside each source */
+    fprintf(fp, "# stands in for the compiler and linker, so only bd itself gets measured\n"
+            "p=; o=; s=\n"
+            "for a; do\n"
+            "    [ \"$p\" = -o ] && o=$a\n"
+            "    case $a in *.c) s=$a;; esac\n"
+            "    p=$a\n"
+            "done\n"
+            ": > \"$o\"\n"
+            "[ -z \"$s\" ] || while IFS= read -r l; do printf '%%s\\n' \"$l\"; done < \"$s.d\" > \"${o%%.o}.d\"\n");
+    fclose(fp);
+    fp = fopen("stubar.sh", "wb");
+    if(!fp) BD_ERR(bd, 0, "Could not create the stub archiver");
+    fprintf(fp, "# stands in for ar, called as: ar rcs LIBRARY OBJECTS...\n"
+            ": > \"$2\"\n");
+    fclose(fp);
+    makedir("inc");
+    makedir("src");
+    for(int h = 0; h < spec->headers; h++) {
+        fp = fopen(path_prf(bd, "inc/h%d.h", h), "wb");
+        if(!fp) BD_ERR(bd, 0, "Could not create header %d", h);
+        fprintf(fp, "#ifndef H%d_H\n#define H%d_H\n", h, h);
+        for(int f = 0; f < spec->fanout; f++) {
+            int child = bench_child(spec, h, f);
+            if(child >= 0) fprintf(fp, "#include \"h%d.h\"\n", child);
+        }
+        fprintf(fp, "int h%d(int x);\n#endif\n", h);
+        fclose(fp);
+    }
+    for(int k = 0; k < spec->projects; k++) {
+        Prj *p = &prjs[k];
+        p->type = types[k % SIZE_ARRAY(types)];
+        p->name = p->type == BUILD_APP ? path_prf(bd, "bin/p%d", k) : p->type == BUILD_EXAMPLES ? path_prf(bd, "ex/p%d", k) : path_prf(bd, "lib/libp%d", k);
+        p->objd = path_prf(bd, "obj/p%d", k);
+        p->cc = "sh stub.sh";
+        p->ar = "sh stubar.sh";
+        p->cflgs = "-O2";
+        p->srcf.s = arena_alloc(&bd->arena, sizeof(*p->srcf.s));
+        if(!p->srcf.s) BD_ERR(bd, 0, "Failed to allocate benchmark project");
+        p->srcf.s[0] = path_prf(bd, "src/p%d/*.c", k);
+        p->srcf.n = 1;
+        /* apps and examples link against the static library of their group */
+        if(p->type == BUILD_APP || p->type == BUILD_EXAMPLES) p->llibs = path_prf(bd, "-L=lib -l=p%d", k - k % (int)SIZE_ARRAY(types));
+        makedir(path_prf(bd, "src/p%d", k));
+    }
+    int *mark = calloc(spec->headers, sizeof(*mark));
+    int *stack = malloc(sizeof(*stack) * (spec->headers * (spec->fanout + 1) + spec->includes + 1));
+    int *users = calloc(spec->headers, sizeof(*users));
+    if(!mark || !stack || !users) {
+        free(mark);
+        free(stack);
+        free(users);
+        BD_ERR(bd, 0, "Failed to allocate benchmark state");
+    }
+    for(int i = 0; i < spec->files && !bd->error; i++) {
+        int k = i % spec->projects;
+        char *srcf = path_prf(bd, "src/p%d/f%d.c", k, i);
+        FILE *src = fopen(srcf, "wb");
+        FILE *dep = fopen(path_prf(bd, "%s.d", srcf), "wb");
+        if(!src || !dep) {
+            if(src) fclose(src);
+            if(dep) fclose(dep);
+            bd->error = __LINE__;
+            break;
+        }
+        fprintf(dep, "obj/p%d/f%d.o: %s", k, i, srcf);
+        /* every header reachable from the source, once */
+        int n = 0;
+        for(int j = 0; j < spec->includes; j++) {
+            int h = (i * 7 + j * 13) % spec->headers;
+            fprintf(src, "#include \"../../inc/h%d.h\"\n", h);
+            stack[n++] = h;
+        }
+        fprintf(src, "int f%d(void) { return %d; }\n", i, i);
+        while(n) {
+            int h = stack[--n];
+            if(mark[h] == i + 1) continue;
+            mark[h] = i + 1;
+            users[h]++;
+            fprintf(dep, " \\\n inc/h%d.h", h);
+            for(int f = 0; f < spec->fanout; f++) {
+                int child = bench_child(spec, h, f);
+                if(child >= 0 && mark[child] != i + 1) stack[n++] = child;
+            }
+        }
+        fprintf(dep, "\n");
+        for(int h = 0; h < spec->headers; h++) {
+            if(mark[h] == i + 1) fprintf(dep, "\ninc/h%d.h:\n", h);
+        }
+        fclose(src);
+        fclose(dep);
+    }
+    /* a typical header, not the worst case */
+    int touch = 0;
+    for(int i = 0; i < spec->headers; i++) stack[i] = users[i];
+    qsort(users, spec->headers, sizeof(*users), bench_cmp);
+    int median = users[spec->headers / 2];
+    for(int i = 0; i < spec->headers; i++) {
+        if(abs(stack[i] - median) < abs(stack[touch] - median)) touch = i;
+    }
+    free(mark);
+    free(stack);
+    free(users);
+    if(bd->error) BD_ERR(bd, 0, "Could not create the benchmark sources");
+    return path_prf(bd, "inc/h%d.h", touch);
+}
+
+/* forget everything, like a new invocation of bd would */
+static void bench_reset(Bd *bd)
+{
+    while(bd->logs) {
+        DepLog *next = bd->logs->next;
+        deplog_flush(bd, bd->logs, true);
+        deplog_free(bd->logs);
+        bd->logs = next;
+    }
+    for(int i = 0; i < bd->nprj; i++) {
+        strarr_free_p(bd->prj[i].srcfs);
+        strarr_free_p(bd->prj[i].supfs);
+    }
+    statcache_free(&bd->stats);
+}
+
+static void bench_run(Bd *bd, BenchSpec *spec, const char *scenario, char *touch)
+{
+    double wall = 0, best = 0, cpu = 0;
+    int jobs = 0;
+    for(int r = 0; r < spec->runs && !bd->error; r++) {
+        if(!touch) {
+            for(int i = 0; i < bd->nprj; i++) clean(bd, &bd->prj[i]);
+        } else if(*touch) {
+            utime(touch, 0);
+        }
+        bench_reset(bd);
+        int count = bd->count;
+        double c = cpu_time();
+        double t = timer_now();
+        build(bd);
+        t = timer_now() - t;
+        cpu += cpu_time() - c;
+        wall += t;
+        best = (!r || t < best) ? t : best;
+        jobs = bd->count - count;
+    }
+    if(bd->error) BD_ERR(bd,, "Benchmark '%s' failed", scenario);
+    printf("{\"bench\":\"build_%s\",\"files\":%d,\"headers\":%d,\"includes\":%d,\"fanout\":%d,\"projects\":%d,\"runs\":%d,\"jobs\":%d,\"min_s\":%.6f,\"mean_s\":%.6f,\"bd_cpu_s\":%.6f}\n",
+            scenario, spec->files, spec->headers, spec->includes, spec->fanout, spec->projects, spec->runs, jobs, best, wall / spec->runs, cpu / spec->runs);
+    fflush(stdout);
+}
+
+/* whole builds of generated projects, with a compiler that does nothing */
+static void bench_projects(Bd *bd, BenchSpec *spec)
+{
+#if defined(OS_WIN)
+    BD_ERR(bd,, "The project benchmarks need a POSIX shell");
+#elif defined(OS_CYGWIN) || defined(OS_APPLE) || defined(OS_ANDROID) || defined(OS_LINUX) || defined(OS_POSIX)
+    char *dir = ".bd_bench";
+    makedir(dir);
+    if(chdir(dir)) BD_ERR(bd,, "Could not enter '%s'", dir);
+    Prj *prj = bd->prj;
+    int nprj = bd->nprj;
+    Prj *prjs = calloc(spec->projects, sizeof(*prjs));
+    char *touch = prjs ? bench_generate(bd, spec, prjs) : 0;
+    if(touch) {
+        bench_reset(bd);
+        bd->prj = prjs;
+        bd->nprj = spec->projects;
+        bench_run(bd, spec, "cold", 0);
+        bench_run(bd, spec, "noop", "");
+        bench_run(bd, spec, "touch_header", touch);
+        bench_run(bd, spec, "touch_source", path_prf(bd, "src/p0/f0.c"));
+        bench_reset(bd);
+        bd->prj = prj;
+        bd->nprj = nprj;
+    }
+    free(prjs);
+    if(chdir("..")) BD_ERR(bd,, "Could not leave '%s'", dir);
+    char *rm = strprf(0, "rm -rf %s", dir);
+    if(rm && system(rm)) BD_VERBOSE(bd, "could not remove '%s'", dir);
+    free(rm);
+    if(!touch) BD_ERR(bd,, "Could not generate the benchmark projects");
+#endif
+}
+
+/* results are printed as one JSON object per line */
+static void bench(Bd *bd, const char *arg)
+{
+    BenchSpec spec = {.files = 1000, .headers = 200, .includes = 10, .fanout = 3, .projects = 4, .runs = 3};
+    if(!bench_spec(bd, arg, &spec)) return;
+    bool verbose = bd->verbose;
+    bool quiet = bd->quiet;
+    bd->verbose = false;
+    bench_dfile(bd, false);
+    bench_dfile(bd, true);
+    bd->quiet = true;
+    if(!bd->error) bench_projects(bd, &spec);
+    bd->verbose = verbose;
+    bd->quiet = quiet;
+}
+
+static void bd_execute(Bd *bd, CmdList cmd, const char *arg)
+{
+    Prj *p = bd->prj;
 
     switch(cmd) {
         case CMD_BUILD: {
-            for(int i = 0; i < (int)SIZE_ARRAY(p); i++) build(bd, &p[i]);
+            build(bd);
+            bd->done = true;
+        } break;
+        case CMD_WATCH: {
+            watch(bd);
             bd->done = true;
         } break;
         case CMD_CLEAN: {
-            for(int i = 0; i < (int)SIZE_ARRAY(p); i++) clean(bd, &p[i]);
+            for(int i = 0; i < bd->nprj; i++) clean(bd, &p[i]);
             bd->done = true;
         } break;
         case CMD_LIST: {
-            for(int i = 0; i < (int)SIZE_ARRAY(p); i++) prj_print(bd, &p[i], true);
+            for(int i = 0; i < bd->nprj; i++) prj_print(bd, &p[i], true);
             bd->done = true;
         } break;
         case CMD_CONFIG: {
-            for(int i = 0; i < (int)SIZE_ARRAY(p); i++) prj_print(bd, &p[i], false);
+            for(int i = 0; i < bd->nprj; i++) prj_print(bd, &p[i], false);
             bd->done = true;
         } break;
         case CMD_OS: {
             printf(OS_STR"\n");
             bd->done = true;
         } break;
+        case CMD_BENCH: {
+            bench(bd, arg);
+            bd->done = true;
+        } break;
+        case CMD_WORKER: {
+            worker(bd, arg);
+            bd->done = true;
+        } break;
         case CMD_HELP: {
-            for(int i = 0; i < CMD__COUNT; i++) printf("%2s%-8s%s\n", "", static_cmds[i], static_cmdsinfo[i]);
+            for(int i = 0; i < CMD__COUNT; i++) {
+                char *usage = strprf(0, "%s%s%s", static_cmds[i], static_cmdsarg[i] ? " " : "", static_cmdsarg[i] ? static_cmdsarg[i] : "");
+                printf("%2s%-16s%s\n", "", usage, static_cmdsinfo[i]);
+                free(usage);
+            }
             bd->done = true;
         } break;
         case CMD_QUIET: {
@@ -799,27 +4488,90 @@ static void bd_execute(Bd *bd, CmdList cmd)
         case CMD_VERBOSE: {
             bd->verbose = true;
         } break;
+        case CMD_HASH: {
+            bd->hash = true;
+        } break;
+        case CMD_CACHE: {
+            if(!arg) BD_ERR(bd,, "No cache folder given");
+            bd->cache = (char *)arg;
+        } break;
+        case CMD_TRACE: {
+            if(!arg) BD_ERR(bd,, "No trace file given");
+            bd->trace = (char *)arg;
+        } break;
+        case CMD_REMOTE: {
+            if(!arg) BD_ERR(bd,, "No workers given");
+            bd->remote = (char *)arg;
+        } break;
+        case CMD_ORDERED: {
+            bd->ordered = true;
+        } break;
+        case CMD_CACHEMAX: {
+            bd->cachemax = arg ? strtoull(arg, 0, 10) << 20 : 0;
+            if(!bd->cachemax) BD_ERR(bd,, "Invalid cache size '%s'", arg ? arg : "");
+        } break;
+        case CMD_JOBS: {
+            /* job slots get reallocated for the new size on the next start */
+            free(bd->job);
+            bd->job = 0;
+            bd->jobs = arg ? atoi(arg) : 0;
+            if(bd->jobs < 1) BD_ERR(bd,, "Invalid number of jobs '%s'", arg ? arg : "");
+        } break;
         default: break;
     }
     if(bd->error) BD_ERR(bd,, "an error occured");
 }
 
-/* TODO maybe add multithreading */
-/* TODO fix potential bug: not checking if file was deleted */
 /* TODO add assembly support */
-/* TODO maybe avoid compilation of equal files in same project e.g. D("*.c", "*.c")*/
 
 /* start of program */
 int main(int argc, const char **argv)
 {
-    Bd bd = {0};
+    Prj p[] = {
+#include CONFIG
+    };
+    Bd bd = {.prj = p, .nprj = SIZE_ARRAY(p), .t0 = timer_now()};
     /* go over command line args */
     for(int i = 1; i < argc; i++) {
         for(CmdList j = 0; j < CMD__COUNT; j++) {
             if(strcmp(argv[i], static_cmds[j])) continue;
-            bd_execute(&bd, j);
+            /* an optional argument is only taken if the next word isn't an option or command itself */
+            bool take = static_cmdsarg[j] && i + 1 < argc;
+            if(take && static_cmdsarg[j][0] == '[') {
+                take = argv[i + 1][0] != '-';
+                for(CmdList k = 0; k < CMD__COUNT && take; k++) take = strcmp(argv[i + 1], static_cmds[k]);
+            }
+            const char *arg = take ? argv[++i] : 0;
+            bd_execute(&bd, j, arg);
+            break;
         }
     }
-    if(!bd.done) bd_execute(&bd, CMD_BUILD);
+    if(!bd.done) bd_execute(&bd, CMD_BUILD, 0);
+    cache_trim(&bd);
+    BD_VERBOSE((&bd), "stat cache: %zu hits, %zu misses, %zu files hashed", bd.stats.hits, bd.stats.misses, bd.stats.hashed);
+    if(bd.cache) BD_VERBOSE((&bd), "object cache: %zu hits, %zu misses, %zu stored", bd.cachehits, bd.cachemisses, bd.cachestored);
+    free(bd.job);
+    jobserver_give(&bd);
+    str_free(&bd.tokens);
+    while(bd.logs) {
+        DepLog *next = bd.logs->next;
+        double t = timer_now();
+        deplog_flush(&bd, bd.logs, true);
+        trace(&bd, "deps", bd.logs->path, t, 0, 0, 0);
+        deplog_free(bd.logs);
+        bd.logs = next;
+    }
+    for(int i = 0; i < bd.nprj; i++) {
+        strarr_free_p(p[i].srcfs);
+        strarr_free_p(p[i].supfs);
+    }
+    trace_write(&bd);
+    free(bd.events);
+    statcache_free(&bd.stats);
+    BD_VERBOSE((&bd), "memory: %zu KiB peak rss, %zu arena allocations (%zu bytes in %zu blocks), %zu paths interned (%zu lookups)",
+            peak_rss(), bd.arena.allocs, bd.arena.bytes, bd.arena.blocks, bd.paths.n, bd.paths.lookups);
+    str_free(&bd.scratch);
+    path_free(&bd.paths);
+    arena_free(&bd.arena);
     return bd.error;
 }